@@ -2,55 +2,322 @@
 #include <fstream>
 #include <string>
 #include <limits>
+#include <cctype>
 #include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#define fsync _commit
+#define fileno _fileno
+#define ftruncate _chsize
+#else
+#include <unistd.h>
+#endif
+#ifdef MIXUE_LIBRARY
+#include "catalog_bench.h"
+#endif
 using namespace std;
 
-const int MAX_ENTRIES=50; 
-const int MAX_CATEGORIES=10; 
+// Built with MIXUE_LIBRARY (the mixue_array_catalog library in CMakeLists.txt) there is no
+// main, and everything below is kept in its own namespace so it can be linked next to mixue.cpp
+#ifdef MIXUE_LIBRARY
+namespace array_catalog {
+#endif
+
+const char* JOURNAL_FILE = "mixue_array.journal";
+const int JOURNAL_COMPACT_RECORDS = 500;   // mixue.txt is rewritten once the journal holds this many changes
 
 struct Drink {
     string name;
-    string category;
+    int category;   // ID in the category dictionary, categoryName() gives the text
     int price;
     int stock;
 };
 
-struct Stack {
-    Drink items[MAX_ENTRIES];
-    int top;
-    
-    Stack() :top(-1) {}
-    
-    bool isEmpty() {
-        return top==-1;
+// Category dictionary. Each distinct category string is stored once and drinks carry its ID,
+// so comparing or sorting by category compares ints. IDs are handed out in the order the
+// categories turn up and never change; categoryRanks gives the alphabetical position.
+vector<string> categoryNames;     // ID -> category
+vector<int> categoryOrder;        // IDs in alphabetical order, grows when a new category turns up
+vector<int> categoryRanks;        // ID -> position in categoryOrder
+
+const string& categoryName(int id) {
+    return categoryNames[id];
+}
+
+// ID of a category, -1 if no drink ever had it
+int findCategory(const string& category) {
+    vector<int>::iterator pos = lower_bound(categoryOrder.begin(), categoryOrder.end(), category,
+                                            [](int id, const string& text) { return categoryNames[id] < text; });
+    if (pos == categoryOrder.end() || categoryNames[*pos] != category) {
+        return -1;
     }
-    
-    bool isFull() {
-        return top==MAX_ENTRIES - 1;
+    return *pos;
+}
+
+// ID of a category, adding it to the dictionary in its alphabetical place if it is new
+int internCategory(const string& category) {
+    vector<int>::iterator pos = lower_bound(categoryOrder.begin(), categoryOrder.end(), category,
+                                            [](int id, const string& text) { return categoryNames[id] < text; });
+    if (pos != categoryOrder.end() && categoryNames[*pos] == category) {
+        return *pos;
     }
-    
-    void push(Drink drink) {
-        if (!isFull()) {
-            items[++top] = drink;
+    int id = categoryNames.size();
+    categoryNames.push_back(category);
+    categoryRanks.push_back(0);
+    int rank = pos - categoryOrder.begin();
+    categoryOrder.insert(pos, id);
+    for (size_t r = rank; r < categoryOrder.size(); r++) {
+        categoryRanks[categoryOrder[r]] = r;
+    }
+    return id;
+}
+
+// 8 bytes of a name starting at from, packed so that comparing two prefixes as numbers
+// orders them like the strings (missing bytes count as 0)
+unsigned long long namePrefix(const string& name, size_t from = 0) {
+    unsigned long long prefix = 0;
+    for (size_t k = from; k < from + 8; k++) {
+        prefix = (prefix << 8) | (k < name.size() ? (unsigned char)name[k] : 0);
+    }
+    return prefix;
+}
+
+// Reads one "name category price stock" record, interning the category
+bool readDrink(istream& in, Drink& drink) {
+    string category;
+    if (!(in >> drink.name >> category >> drink.price >> drink.stock)) {
+        return false;
+    }
+    drink.category = internCategory(category);
+    return true;
+}
+
+// Names and categories are read back one word at a time, so they cannot be empty or hold spaces
+bool isSingleWord(const string& s) {
+    if (s.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i < s.size(); i++) {
+        if (isspace((unsigned char)s[i])) {
+            return false;
         }
     }
-    
-    Drink pop() {
-        if (!isEmpty()) {
-            return items[top--];
+    return true;
+}
+
+// Where one category's drinks sit in the sorted rows
+struct CategoryRange {
+    int start;          // First and last row, start is -1 if the category has no drinks
+    int end;
+    int tree;           // Its name tree starts at nameTree[tree + 1]
+    size_t common;      // Length of the prefix every name in the range shares
+    bool shortNames;    // Every name ends within 8 bytes after that prefix, so its key is the whole rest
+};
+
+// One node of a category's name tree
+struct NameNode {
+    unsigned long long key;    // namePrefix of the name after the range's common prefix
+    int row;
+};
+
+// Resident copy of sorted_information.txt shared by search and the sorted display.
+// The file is parsed again only when its identity changes: a different inode (every
+// atomic save renames a new file into place), size or modification time.
+// Each parse also builds a directory from category to its rows, and per category the
+// names in Eytzinger order (node k has children 2k and 2k+1), so a lookup is a short
+// loop of integer compares that walks down one array.
+struct SortedCache {
+    string path;
+    vector<Drink> rows;
+    vector<CategoryRange> directory;   // Indexed by category ID
+    vector<NameNode> nameTree;
+    bool loaded;
+    unsigned long long inode;
+    long long size;
+    long long modified;
+    int reloads;        // Times the file has actually been parsed
+
+    SortedCache(const string& file) : path(file), loaded(false), inode(0), size(0), modified(0), reloads(0) {}
+
+    // The current rows, reparsing the file first if it changed. Empty if it cannot be read.
+    const vector<Drink>& get() {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            rows.clear();
+            loaded = false;
+            return rows;
+        }
+        if (loaded && inode == (unsigned long long)st.st_ino && size == (long long)st.st_size
+            && modified == (long long)st.st_mtime) {
+            return rows;
+        }
+        rows.clear();
+        ifstream file(path.c_str());
+        Drink row;
+        while (readDrink(file, row)) {
+            rows.push_back(row);
         }
-        return Drink(); 
+        buildDirectory();
+        loaded = true;
+        inode = st.st_ino;
+        size = st.st_size;
+        modified = st.st_mtime;
+        reloads++;
+        return rows;
     }
-    
-    int size() {
-        return top + 1;
+
+    // Fills rows from drinks in the given order, as if the file had just been read
+    void fill(const Drink all[], const vector<int>& order) {
+        rows.clear();
+        rows.reserve(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            rows.push_back(all[order[i]]);
+        }
+        buildDirectory();
+        loaded = true;
+        remember();
+    }
+
+    // Takes the file as it is now to match rows, so get() only parses it again after
+    // something else changes it
+    void remember() {
+        struct stat st;
+        if (path.empty() || stat(path.c_str(), &st) != 0) {
+            inode = 0;
+            size = -1;
+            modified = 0;
+            return;
+        }
+        inode = st.st_ino;
+        size = st.st_size;
+        modified = st.st_mtime;
+    }
+
+    // Rebuilds directory and nameTree from rows, which are grouped by category and sorted
+    // by name inside each group. A category split over several runs keeps only its first.
+    void buildDirectory() {
+        CategoryRange none = {-1, -1, 0, 0, false};
+        directory.assign(categoryNames.size(), none);
+        nameTree.assign(rows.size() + categoryNames.size(), NameNode());
+        int tree = 0;
+        int start = 0;
+        while (start < (int)rows.size()) {
+            int category = rows[start].category;
+            int end = start;
+            while (end + 1 < (int)rows.size() && rows[end + 1].category == category) {
+                end++;
+            }
+            CategoryRange& range = directory[category];
+            if (range.start < 0) {
+                const string& first = rows[start].name;
+                const string& last = rows[end].name;
+                range.start = start;
+                range.end = end;
+                range.tree = tree;
+                range.common = 0;
+                while (range.common < first.size() && range.common < last.size()
+                       && first[range.common] == last[range.common]) {
+                    range.common++;
+                }
+                range.shortNames = true;
+                for (int row = start; row <= end; row++) {
+                    range.shortNames = range.shortNames && rows[row].name.size() <= range.common + 8;
+                }
+                int next = start;
+                fillNameTree(range, 1, end - start + 1, next);
+                tree += end - start + 2;
+            }
+            start = end + 1;
+        }
+    }
+
+    // In-order walk of the implicit tree, so node keys come out in row order
+    void fillNameTree(const CategoryRange& range, int k, int size, int& next) {
+        if (k > size) {
+            return;
+        }
+        fillNameTree(range, 2 * k, size, next);
+        nameTree[range.tree + k].key = namePrefix(rows[next].name, range.common);
+        nameTree[range.tree + k].row = next++;
+        fillNameTree(range, 2 * k + 1, size, next);
+    }
+
+    // First and last row of a category, false if it has none
+    bool categoryRows(int category, int& start, int& end) const {
+        if (category < 0 || category >= (int)directory.size() || directory[category].start < 0) {
+            return false;
+        }
+        start = directory[category].start;
+        end = directory[category].end;
+        return true;
+    }
+
+    // Row of the drink with this name in the category, -1 if there is none.
+    // Descends the category's tree taking the right child while the node's key is smaller,
+    // which needs no branch on the compare; the answer is the last node where it went left.
+    // The 16 nodes four levels down are contiguous, so they are fetched while the current
+    // level is compared, and the answer's row comes from a node already in cache. Names are
+    // only compared as strings when keys tie and the range has names longer than its keys.
+    int findName(int category, const string& name) const {
+        int start, end;
+        if (!categoryRows(category, start, end)) {
+            return -1;
+        }
+        const CategoryRange& range = directory[category];
+        if (name.compare(0, range.common, rows[start].name, 0, range.common) != 0) {
+            return -1;
+        }
+        if (range.shortNames && name.size() > range.common + 8) {
+            return -1;
+        }
+        unsigned long long key = namePrefix(name, range.common);
+        const NameNode* tree = &nameTree[range.tree];
+        unsigned size = end - start + 1;
+        unsigned k = 1;
+        while (k <= size) {
+#if defined(__GNUC__)
+            const NameNode* below = tree + 16 * k;   // 256 bytes, four cache lines
+            __builtin_prefetch(below);
+            __builtin_prefetch(below + 4);
+            __builtin_prefetch(below + 8);
+            __builtin_prefetch(below + 12);
+#endif
+            k = 2 * k + (tree[k].key < key);
+        }
+        while (k & 1) {     // Undo the right turns taken after the last left turn
+            k >>= 1;
+        }
+        k >>= 1;
+        if (k == 0 || tree[k].key != key) {
+            return -1;
+        }
+        if (range.shortNames) {
+            return tree[k].row;
+        }
+        for (int row = tree[k].row; row <= end && namePrefix(rows[row].name, range.common) == key; row++) {
+            if (rows[row].name == name) {
+                return row;
+            }
+        }
+        return -1;
     }
 };
 
-Drink drinks[MAX_ENTRIES];
-string categories[MAX_CATEGORIES];
-int totalEntries = 0;
-int totalCategories = 0;
+vector<Drink> drinks;          // Grows as drinks are added, no fixed limit
+FILE* journal = NULL;
+int journalRecords = 0;
+vector<int> sortedView;          // drinks[] indices in sorted_information.txt order, updated by every change
+bool sortedFileStale = false;    // sorted_information.txt is only rewritten by Sort and Save, or on exit
+bool sortedCacheStale = true;    // sortedCache is behind sortedView
+SortedCache sortedCache("sorted_information.txt");
 
 void clearScreen() {
     system("cls || clear"); 
@@ -70,114 +337,363 @@ void waitForEnter() {
 }
 
 void initializeCategories() { 
-    categories[totalCategories++] = "Beverage";
-    categories[totalCategories++] = "Juice";
-    categories[totalCategories++] = "Tea";
+    internCategory("Beverage");
+    internCategory("Juice");
+    internCategory("Tea");
 }
 
-void readDataFromFile() {
-    ifstream file("mixue.txt");
+void readDataFromFile(const string& path = "mixue.txt") {
+    ifstream file(path.c_str());
     if (!file.is_open()) {
-        cout << "mixue.txt not found.\n";
+        cout << path << " not found.\n";
         return;
     }
 
-    totalEntries = 0;
-    while (file >> drinks[totalEntries].name 
-                >> drinks[totalEntries].category 
-                >> drinks[totalEntries].price 
-                >> drinks[totalEntries].stock) {
-        totalEntries++;
-        if (totalEntries >= MAX_ENTRIES) break;
+    drinks.clear();
+    string line;
+    int lineNumber = 0;
+    int skipped = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        istringstream in(line);
+        Drink drink;
+        if (readDrink(in, drink)) {
+            drinks.push_back(drink);
+        } else if (line.find_first_not_of(" \t\r") != string::npos) {
+            if (skipped++ < 5) {
+                cout << "Skipped line " << lineNumber << " of " << path << ", it is not \"name category price stock\"\n";
+            }
+        }
     }
     file.close();
+    if (skipped > 0) {
+        cout << skipped << " line(s) of " << path << " could not be read.\n";
+        waitForEnter();
+    }
 }
 
-void saveDataToFile() {
-    ofstream file("mixue.txt");
-    if (!file.is_open()) {
-        cout << "Error saving to mixue.txt\n";
-        return;
+// Replaces a file so that readers and crashes only ever see the old or the new contents:
+// write it all to <path>.tmp, fsync, then rename over the old file (rename is atomic).
+// On POSIX the directory is fsynced too, so the rename itself survives a power loss.
+bool writeFileAtomically(const string& path, const string& contents) {
+    string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < contents.size()) {
+        long n = write(fd, contents.data() + done, contents.size() - done);
+        if (n <= 0) {
+            close(fd);
+            remove(tmp.c_str());
+            return false;
+        }
+        done += n;
     }
+    bool ok = fsync(fd) == 0;
+    ok = close(fd) == 0 && ok;
+#ifdef _WIN32
+    remove(path.c_str());   // rename cannot replace a file on Windows, so this step is not atomic there
+#endif
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+#ifndef _WIN32
+    size_t slash = path.find_last_of('/');
+    string dir = slash == string::npos ? "." : path.substr(0, slash + 1);
+    int dirFd = open(dir.c_str(), O_RDONLY);
+    if (dirFd < 0) {
+        return false;
+    }
+    ok = fsync(dirFd) == 0;
+    ok = close(dirFd) == 0 && ok;
+#endif
+    return ok;
+}
 
-    for (int i = 0; i < totalEntries; i++) {
+bool saveDataToFile(const string& path = "mixue.txt") {
+    ostringstream file;
+    for (size_t i = 0; i < drinks.size(); i++) {
         file <<drinks[i].name<< " " 
-             <<drinks[i].category<< " " 
+             <<categoryName(drinks[i].category)<< " " 
              <<drinks[i].price<< " " 
              <<drinks[i].stock<< "\n";
     }
-    file.close();
+    if (!writeFileAtomically(path, file.str())) {
+        cout << "Error saving to " << path << "\n";
+        return false;
+    }
+    return true;
 }
 
-void saveSortedDataToFile() {
-    ofstream file("sorted_information.txt");
-    if (!file.is_open()) {
-        cout << "Cannot save to sorted_information.txt\n";
+// FNV-1a checksum of a whole file, 0 if it cannot be read
+unsigned long long fileChecksum(const char* path) {
+    ifstream file(path, ios::binary);
+    if (!file) {
+        return 0;
+    }
+    unsigned long long hash = 14695981039346656037ULL;
+    char c;
+    while (file.get(c)) {
+        hash = (hash ^ (unsigned char)c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// The journal records changes to drinks[] instead of rewriting mixue.txt each time:
+//   B checksum                     first line, checksum of the mixue.txt it applies to
+//   A name category price stock    drink appended
+//   E index name category price stock   drink at index replaced
+//   D index                        drink at index removed
+// It is replayed after mixue.txt is read, and folded back into mixue.txt once it
+// gets long or when the program exits.
+//
+// journalSync is false if the journal is open but its records could not be written and synced
+bool journalSync() {
+    if (journal == NULL) {
+        return true;
+    }
+    bool ok = fflush(journal) == 0;
+    ok = fsync(fileno(journal)) == 0 && ok;
+    if (!ok) {
+        cout << "Cannot write " << JOURNAL_FILE << ", recent changes may not be saved\n";
+    }
+    return ok;
+}
+
+void startJournal() {
+    if (journal != NULL) {
+        fclose(journal);
+    }
+    journal = fopen(JOURNAL_FILE, "w");
+    if (journal == NULL) {
+        cout << "Cannot open " << JOURNAL_FILE << "\n";
         return;
     }
-    Drink sorted[MAX_ENTRIES];
+    fprintf(journal, "B %llu\n", fileChecksum("mixue.txt"));
+    journalSync();
+    journalRecords = 0;
+}
 
-    int categoryCount[MAX_CATEGORIES] = {0};
-    for (int i=0; i<totalEntries; i++) {
-        for (int j=0; j<totalCategories; j++) {
-            if (drinks[i].category == categories[j]) {
-                categoryCount[j]++;
-                break;
-            }
+void journalAppend(char op, int index, const Drink& drink) {
+    if (journal == NULL) {
+        return;
+    }
+    if (op == 'D') {
+        fprintf(journal, "D %d\n", index);
+    } else if (op == 'E') {
+        fprintf(journal, "E %d %s %s %d %d\n", index, drink.name.c_str(), categoryName(drink.category).c_str(),
+                drink.price, drink.stock);
+    } else {
+        fprintf(journal, "A %s %s %d %d\n", drink.name.c_str(), categoryName(drink.category).c_str(),
+                drink.price, drink.stock);
+    }
+    journalRecords++;
+}
+
+void compactJournal();
+
+void replayJournal() {
+    ifstream file(JOURNAL_FILE);
+    string op;
+    unsigned long long checksum;
+    if (!(file >> op >> checksum) || op != "B" || checksum != fileChecksum("mixue.txt")) {
+        file.close();
+        startJournal();     // No journal, or it belongs to an older mixue.txt
+        return;
+    }
+    string line;
+    if (!getline(file, line) || file.eof()) {
+        file.close();
+        startJournal();     // Only a torn B line, there are no records to keep
+        return;
+    }
+    streamoff complete = file.tellg();    // End of the last line that has its newline
+    while (getline(file, line)) {
+        if (file.eof()) {
+            break;      // Last line has no newline, it was cut off by a crash
+        }
+        complete = file.tellg();
+        istringstream in(line);
+        Drink drink;
+        int index = -1;
+        in >> op;
+        if (op == "D" && in >> index && index >= 0 && index < (int)drinks.size()) {
+            drinks.erase(drinks.begin() + index);
+        } else if (op == "E" && in >> index && index >= 0 && index < (int)drinks.size() && readDrink(in, drink)) {
+            drinks[index] = drink;
+        } else if (op == "A" && readDrink(in, drink)) {
+            drinks.push_back(drink);
+        } else {
+            continue;
         }
+        journalRecords++;
     }
+    file.close();
+    // Cut off a torn last line, or the next record would be written onto the end of it
+    int fd = open(JOURNAL_FILE, O_WRONLY);
+    bool ok = fd >= 0 && ftruncate(fd, complete) == 0 && fsync(fd) == 0;
+    if (fd >= 0) {
+        ok = close(fd) == 0 && ok;
+    }
+    if (!ok) {
+        cout << "Cannot repair " << JOURNAL_FILE << ", compacting instead\n";
+        compactJournal();
+        return;
+    }
+    journal = fopen(JOURNAL_FILE, "a");
+}
 
-    int categoryIndex[MAX_CATEGORIES] = {0};
-    for (int i=1; i<totalCategories; i++) {
-        categoryIndex[i] = categoryIndex[i-1] + categoryCount[i-1];
+// Rewrite mixue.txt from drinks[] and start an empty journal. If mixue.txt cannot be
+// written the journal is kept and appended to, it is the only copy of the changes.
+void compactJournal() {
+    journalSync();
+    if (saveDataToFile()) {
+        startJournal();
     }
+}
 
-    Stack categoryStacks[MAX_CATEGORIES];
-    for (int i=0; i<totalEntries; i++) {
-        for (int j = 0; j<totalCategories; j++) {
-            if (drinks[i].category == categories[j]) {
-                categoryStacks[j].push(drinks[i]);
-                break;
-            }
-        }
+// Called after each menu action: one fsync for all of its changes
+void commitJournal() {
+    journalSync();
+    if (journalRecords >= JOURNAL_COMPACT_RECORDS) {
+        compactJournal();
     }
+}
 
-    Drink tempSorted[MAX_ENTRIES];
-    int currentIndex = 0;
-    for (int cat = 0; cat < totalCategories; cat++) {
+// A drink's position in the array plus the first 8 bytes of its name packed so that
+// comparing two prefixes as numbers orders them like the strings. Most comparisons are
+// settled by the prefix without touching the Drink at all.
+struct SortKey {
+    unsigned long long prefix;
+    int index;
+};
 
-        Drink tempCategory[MAX_ENTRIES];
-        int tempCount = 0;
-        while (!categoryStacks[cat].isEmpty()) {
-            tempCategory[tempCount++] = categoryStacks[cat].pop();
-        }
+// Order of the drinks in sorted_information.txt: by category in alphabetical order, then
+// by name. One counting pass buckets the drinks by category rank and each bucket is sorted
+// by name, moving only small keys so no Drink (or its strings) is ever copied.
+// Drinks with the same name keep their array order.
+vector<int> sortedDrinkOrder(const Drink list[], int count) {
+    int totalCategories = categoryOrder.size();
+    vector<int> start(totalCategories + 1, 0);
+    for (int i = 0; i < count; i++) {
+        start[categoryRanks[list[i].category] + 1]++;
+    }
+    for (int j = 0; j < totalCategories; j++) {
+        start[j+1] += start[j];
+    }
 
-        for (int i=1; i<tempCount; i++) {
-            Drink key = tempCategory[i];
-            int j=i-1;
-            while (j>=0 && tempCategory[j].name > key.name) {
-                tempCategory[j+1] = tempCategory[j];
-                j--;
-            }
-            tempCategory[j+1] = key;
-        }
+    vector<SortKey> keys(count);
+    vector<int> next(start.begin(), start.end() - 1);
+    for (int i = 0; i < count; i++) {
+        SortKey& key = keys[next[categoryRanks[list[i].category]]++];
+        key.prefix = namePrefix(list[i].name);
+        key.index = i;
+    }
+    for (int j = 0; j < totalCategories; j++) {
+        sort(keys.begin() + start[j], keys.begin() + start[j+1], [list](const SortKey& a, const SortKey& b) {
+            if (a.prefix != b.prefix) return a.prefix < b.prefix;
+            int c = list[a.index].name.compare(list[b.index].name);
+            return c != 0 ? c < 0 : a.index < b.index;
+        });
+    }
+
+    vector<int> order(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        order[i] = keys[i].index;
+    }
+    return order;
+}
 
-        for (int i=0; i<tempCount; i++) {
-            tempSorted[currentIndex++] = tempCategory[i];
+string formatDrinks(const Drink list[], const vector<int>& order) {
+    ostringstream file;
+    for (size_t i = 0; i < order.size(); i++) {
+        const Drink& drink = list[order[i]];
+        file << drink.name << " " 
+             << categoryName(drink.category) << " " 
+             << drink.price << " " 
+             << drink.stock << "\n";
+    }
+    return file.str();
+}
+
+// True if drinks[a] comes before drinks[b] in the sorted view. Same order as
+// sortedDrinkOrder: category, then name, then array position.
+bool sortedBefore(int a, int b) {
+    int rankA = categoryRanks[drinks[a].category];
+    int rankB = categoryRanks[drinks[b].category];
+    if (rankA != rankB) return rankA < rankB;
+    int c = drinks[a].name.compare(drinks[b].name);
+    return c != 0 ? c < 0 : a < b;
+}
+
+// Adds drinks[index] to the sorted view: a binary search for its place, then one insert
+// that only moves ints
+void indexDrink(int index) {
+    sortedView.insert(lower_bound(sortedView.begin(), sortedView.end(), index, sortedBefore), index);
+    sortedFileStale = true;
+    sortedCacheStale = true;
+}
+
+// Takes drinks[index] out of the sorted view. Must be called before the drink changes.
+void unindexDrink(int index) {
+    vector<int>::iterator pos = lower_bound(sortedView.begin(), sortedView.end(), index, sortedBefore);
+    if (pos != sortedView.end() && *pos == index) {
+        sortedView.erase(pos);
+    }
+    sortedFileStale = true;
+    sortedCacheStale = true;
+}
+
+// For a drink about to be removed from drinks[]: drop it from the view and renumber the
+// drinks after it, which are about to shift down one place
+void removeFromSortedView(int index) {
+    unindexDrink(index);
+    for (size_t i = 0; i < sortedView.size(); i++) {
+        if (sortedView[i] > index) {
+            sortedView[i]--;
         }
     }
+}
 
-    for (int i = 0; i < totalEntries; i++) {
-        sorted[i] = tempSorted[i];
+// After sorted_information.txt has been written from sortedView: the cache takes the same
+// rows, so it only parses the file again if something else changes it
+void sortedFileWritten() {
+    sortedFileStale = false;
+    sortedCache.fill(drinks.data(), sortedView);
+    sortedCacheStale = false;
+}
+
+void saveSortedDataToFile() {
+    if (!writeFileAtomically("sorted_information.txt", formatDrinks(drinks.data(), sortedView))) {
+        cout << "Cannot save to sorted_information.txt\n";
+        return;
     }
+    sortedFileWritten();
+}
 
-    for (int i = 0; i < totalEntries; i++) {
-        file << sorted[i].name << " " 
-             << sorted[i].category << " " 
-             << sorted[i].price << " " 
-             << sorted[i].stock << "\n";
+// Brings sorted_information.txt up to date, if any change has been made since it was written
+void flushSortedFile() {
+    if (sortedFileStale) {
+        saveSortedDataToFile();
     }
-    file.close();
+}
+
+// The sorted catalog for display and search. Changes made here are copied over from
+// sortedView without writing the file; the file is parsed again only if it is up to date
+// with drinks[] and something else has rewritten it since.
+const vector<Drink>& sortedRows() {
+    if (sortedCacheStale) {
+        sortedCache.fill(drinks.data(), sortedView);
+        sortedCacheStale = false;
+        return sortedCache.rows;
+    }
+    if (sortedFileStale) {
+        return sortedCache.rows;
+    }
+    return sortedCache.get();
 }
 
 void displayDrinks(bool showSorted = false) {
@@ -188,24 +704,22 @@ void displayDrinks(bool showSorted = false) {
     cout << string(55, '-') << "\n";
 
     if (showSorted) {
-        ifstream file("sorted_information.txt");
-        if (!file.is_open()) {
+        const vector<Drink>& sorted = sortedRows();
+        if (sorted.empty()) {
             cout << "No data available.\n";
             return;
         }
 
-        Drink temp;
-        while (file >> temp.name >> temp.category >> temp.price >> temp.stock) {
-            cout << left << setw(20) << temp.name 
-                 << setw(15) << temp.category 
-                 << setw(10) << temp.price 
-                 << setw(10) << temp.stock << "\n";
+        for (size_t i = 0; i < sorted.size(); i++) {
+            cout << left << setw(20) << sorted[i].name 
+                 << setw(15) << categoryName(sorted[i].category) 
+                 << setw(10) << sorted[i].price 
+                 << setw(10) << sorted[i].stock << "\n";
         }
-        file.close();
     } else {
-        for (int i = 0; i < totalEntries; i++) {
+        for (size_t i = 0; i < drinks.size(); i++) {
             cout << left << setw(20) << drinks[i].name 
-                 << setw(15) << drinks[i].category 
+                 << setw(15) << categoryName(drinks[i].category) 
                  << setw(10) << drinks[i].price 
                  << setw(10) << drinks[i].stock << "\n";
         }
@@ -237,20 +751,27 @@ void addNewDrinks() {
 
     for (int i = 0; i < numToAdd; i++) {
         displayHeader("Add Drink #" + to_string(i+1));
+        Drink drink;
         
-        cout << "Name: ";
-        getline(cin, drinks[totalEntries].name);
+        while (true) {
+            cout << "Name: ";
+            getline(cin, drink.name);
+            if (isSingleWord(drink.name)) {
+                break;
+            }
+            cout << "Invalid name, use one word with no spaces. Try again.\n";
+        }
         
         cout << "Available Categories:\n";
-        for (int j = 0; j < totalCategories; j++) {
-            cout << j+1 << ". " << categories[j] << "\n";
+        for (size_t j = 0; j < categoryOrder.size(); j++) {
+            cout << j+1 << ". " << categoryName(categoryOrder[j]) << "\n";
         }
         
         int catChoice;
         while (true) {
-            cout << "Select Category (1-" << totalCategories << "): ";
+            cout << "Select Category (1-" << categoryOrder.size() << "): ";
             cin >> catChoice;
-            if (cin.fail() || catChoice < 1 || catChoice > totalCategories) {
+            if (cin.fail() || catChoice < 1 || catChoice > (int)categoryOrder.size()) {
                 cin.clear();
                 cin.ignore(numeric_limits<streamsize>::max(), '\n');
                 cout << "Invalid choice. Try again.\n";
@@ -259,11 +780,11 @@ void addNewDrinks() {
             }
         }
         cin.ignore();
-        drinks[totalEntries].category = categories[catChoice-1];
+        drink.category = categoryOrder[catChoice-1];
         
         while (true) {
             cout << "Price: ";
-            cin >> drinks[totalEntries].price;
+            cin >> drink.price;
             if (cin.fail()) {
                 cin.clear();
                 cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -275,7 +796,7 @@ void addNewDrinks() {
         
         while (true) {
             cout << "Stock: ";
-            cin >> drinks[totalEntries].stock;
+            cin >> drink.stock;
             if (cin.fail()) {
                 cin.clear();
                 cin.ignore(numeric_limits<streamsize>::max(), '\n');
@@ -286,10 +807,11 @@ void addNewDrinks() {
         }
         cin.ignore();
 
-        totalEntries++;
-        saveDataToFile();
-        saveSortedDataToFile();
+        drinks.push_back(drink);
+        journalAppend('A', drinks.size() - 1, drink);
+        indexDrink(drinks.size() - 1);
     }
+    commitJournal();
     
     cout << numToAdd << " drinks added successfully!\n";
     waitForEnter();
@@ -298,7 +820,7 @@ void addNewDrinks() {
 void editDrink() {
     displayHeader("Edit Drink");
     
-    if (totalEntries == 0) {
+    if (drinks.empty()) {
         cout << "No drinks available to edit.\n";
         waitForEnter();
         return;
@@ -307,10 +829,10 @@ void editDrink() {
     cout << left << setw(5) << "No." << setw(20) << "Name" << setw(15) << "Category" 
          << setw(10) << "Price" << setw(10) << "Stock" << "\n";
     cout << string(55, '-') << "\n";
-    for (int i = 0; i < totalEntries; i++) {
+    for (size_t i = 0; i < drinks.size(); i++) {
         cout << left << setw(5) << i+1 
              << setw(20) << drinks[i].name 
-             << setw(15) << drinks[i].category 
+             << setw(15) << categoryName(drinks[i].category) 
              << setw(10) << drinks[i].price 
              << setw(10) << drinks[i].stock << "\n";
     }
@@ -332,8 +854,8 @@ void editDrink() {
             return;
         }
         
-        if (choice < 1 || choice > totalEntries) {
-            cout << "Invalid choice. Please select 1-" << totalEntries << ".\n";
+        if (choice < 1 || choice > (int)drinks.size()) {
+            cout << "Invalid choice. Please select 1-" << drinks.size() << ".\n";
         } else {
             break;
         }
@@ -341,21 +863,36 @@ void editDrink() {
     cin.ignore();
     
     Drink& drink = drinks[choice-1];
+    unindexDrink(choice - 1);
     cout << "\nEditing: " << drink.name << "\n";
     
-    cout << "New name (" << drink.name << "): ";
     string newName;
-    getline(cin, newName);
+    while (true) {
+        cout << "New name (" << drink.name << "): ";
+        getline(cin, newName);
+        if (newName.empty() || isSingleWord(newName)) {
+            break;
+        }
+        cout << "Invalid name, use one word with no spaces. Try again.\n";
+    }
     if (!newName.empty()) drink.name = newName;
     
     cout << "Available Categories:\n";
-    for (int j = 0; j < totalCategories; j++) {
-        cout << j+1 << ". " << categories[j] << "\n";
+    for (size_t j = 0; j < categoryOrder.size(); j++) {
+        cout << j+1 << ". " << categoryName(categoryOrder[j]) << "\n";
     }
-    cout << "New category (" << drink.category << "): ";
     string newCat;
-    getline(cin, newCat);
-    if (!newCat.empty()) drink.category = newCat;
+    while (true) {
+        cout << "New category (" << categoryName(drink.category) << "): ";
+        getline(cin, newCat);
+        if (newCat.empty() || isSingleWord(newCat)) {
+            break;
+        }
+        cout << "Invalid category, use one word with no spaces. Try again.\n";
+    }
+    if (!newCat.empty()) {
+        drink.category = internCategory(newCat);
+    }
     
     cout << "New price (" << drink.price << "): ";
     string newPrice;
@@ -367,16 +904,19 @@ void editDrink() {
     getline(cin, newStock);
     if (!newStock.empty()) drink.stock = stoi(newStock);
     
-    saveDataToFile();
-    saveSortedDataToFile();
+    journalAppend('E', choice - 1, drink);
+    commitJournal();
+    indexDrink(choice - 1);
     cout << "Drink updated successfully!\n";
     waitForEnter();
 }
 
-Drink* loadSortedDrinks(int& size) {
-    ifstream file("sorted_information.txt");
+// The old way search got the sorted catalog: count the lines, then open and parse the file
+// again into a fresh array. Only used by the search benchmark now.
+Drink* legacyLoadSortedDrinks(const string& path, int& size) {
+    ifstream file(path.c_str());
     if (!file.is_open()) {
-        cout << "Cannot open sorted_information.txt\n";
+        cout << "Cannot open " << path << "\n";
         size = 0;
         return nullptr;
     }
@@ -389,16 +929,17 @@ Drink* loadSortedDrinks(int& size) {
     file.close();
     
     Drink* sortedDrinks = new Drink[size];
-    file.open("sorted_information.txt");
+    file.open(path.c_str());
     for (int i = 0; i < size; i++) {
-        file >> sortedDrinks[i].name >> sortedDrinks[i].category 
-             >> sortedDrinks[i].price >> sortedDrinks[i].stock;
+        readDrink(file, sortedDrinks[i]);
     }
     file.close();
     return sortedDrinks;
 }
 
-int ternarySearch(Drink arr[], int l, int r, const string& x) {
+// The old name lookup and category search, kept for the benchmarks: a recursive ternary
+// search by name, and two binary searches for the category's first and last row.
+int ternarySearch(const Drink arr[], int l, int r, const string& x) {
     if (r >= l) {
         int mid1 = l + (r - l) / 3;
         int mid2 = r - (r - l) / 3;
@@ -415,67 +956,79 @@ int ternarySearch(Drink arr[], int l, int r, const string& x) {
     return -1;
 }
 
-void searchDrink() {
-    displayHeader("Search Drink");
-    
-    if (totalEntries == 0) {
-        cout << "No drinks available to search.\n";
-        waitForEnter();
-        return;
-    }
-    
-    string category;
-    cout << "Enter drink category (0 to return): ";
-    getline(cin, category);
-    
-    if (category == "0") {
-        return;
-    }
-    
-    int size;
-    Drink* sortedDrinks = loadSortedDrinks(size);
-    if (size == 0) {
-        cout << "No data available.\n";
-        waitForEnter();
-        return;
-    }
-    
+// First and last position of a category in a sorted catalog, found with two binary searches
+// that compare category ranks. Returns false if no drink has that category.
+// searchDrink uses SortedCache::categoryRows instead.
+bool categoryRange(const Drink sortedDrinks[], int size, int category, int& start, int& end) {
+    int rank = categoryRanks[category];
     int left = 0;
     int right = size - 1;
-    int start = -1;
+    start = -1;
     while (left<=right) {
         int mid=left + (right-left) / 2;
         if (sortedDrinks[mid].category == category) {
             start=mid;
             right= mid-1; 
-        } else if (sortedDrinks[mid].category<category) {
+        } else if (categoryRanks[sortedDrinks[mid].category]<rank) {
             left= mid+1;
         } else {
             right= mid-1;
         }
     }
-    
     if (start == -1) {
-        cout << "Category not found.\n";
-        delete[] sortedDrinks;
-        waitForEnter();
-        return;
+        return false;
     }
     
     left=start;
     right=size - 1;
-    int end=start;
+    end=start;
     while (left<=right) {
         int mid = left + (right - left) / 2;
         if (sortedDrinks[mid].category == category) {
             end=mid;
             left=mid + 1; 
-        } else if (sortedDrinks[mid].category < category) {
+        } else if (categoryRanks[sortedDrinks[mid].category] < rank) {
             left=mid + 1;
         } else {
             right=mid - 1;
         }
     }
+    return true;
+}
+
+void searchDrink() {
+    displayHeader("Search Drink");
+    
+    if (drinks.empty()) {
+        cout << "No drinks available to search.\n";
+        waitForEnter();
+        return;
+    }
+    
+    string category;
+    cout << "Enter drink category (0 to return): ";
+    getline(cin, category);
+    
+    if (category == "0") {
+        return;
+    }
+    
+    const vector<Drink>& sorted = sortedRows();
+    const Drink* sortedDrinks = sorted.data();
+    int size = sorted.size();
+    if (size == 0) {
+        cout << "No data available.\n";
+        waitForEnter();
+        return;
+    }
+    
+    int start, end;
+    int categoryId = findCategory(category);
+    if (!sortedCache.categoryRows(categoryId, start, end)) {
+        cout << "Category not found.\n";
+        waitForEnter();
+        return;
+    }
     
     cout << "\nDrinks in category " <<category<< ":\n";
     cout << setw(20) << "Name" << setw(15) << "Category" 
@@ -483,7 +1036,7 @@ void searchDrink() {
     cout << string(55, '-') << "\n";
     for (int i = start; i <= end; i++) {
         cout << setw(20) << sortedDrinks[i].name 
-             << setw(15) << sortedDrinks[i].category 
+             << setw(15) << categoryName(sortedDrinks[i].category) 
              << setw(10) << sortedDrinks[i].price 
              << setw(10) << sortedDrinks[i].stock << "\n";
     }
@@ -493,29 +1046,27 @@ void searchDrink() {
     getline(cin, name);
     
     if (name == "0") {
-        delete[] sortedDrinks;
         return; 
     }
     
-    int result = ternarySearch(sortedDrinks, start, end, name);
+    int result = sortedCache.findName(categoryId, name);
     if (result != -1) {
         cout << "\nDrink Found:\n";
         cout << "Name: " <<sortedDrinks[result].name << "\n";
-        cout << "Category: " <<sortedDrinks[result].category << "\n";
+        cout << "Category: " <<categoryName(sortedDrinks[result].category) << "\n";
         cout << "Price: " <<sortedDrinks[result].price << "\n";
         cout << "Stock: " <<sortedDrinks[result].stock << "\n";
     } else {
         cout << "Drink not found in category " <<category<< ".\n";
     }
     
-    delete[] sortedDrinks;
     waitForEnter();
 }
 
 void removeDrink() {
     displayHeader("Remove Drink");
     
-    if (totalEntries == 0) {
+    if (drinks.empty()) {
         cout<< "No drinks available to remove.\n";
         waitForEnter();
         return;
@@ -524,10 +1075,10 @@ void removeDrink() {
     cout << left << setw(5) << "No." << setw(20) << "Name" << setw(15) << "Category" 
          << setw(10) << "Price" << setw(10) << "Stock" << "\n";
     cout << string(55, '-') << "\n";
-    for (int i = 0; i < totalEntries; i++) {
+    for (size_t i = 0; i < drinks.size(); i++) {
         cout << left << setw(5) << i+1 
              << setw(20) << drinks[i].name 
-             << setw(15) << drinks[i].category 
+             << setw(15) << categoryName(drinks[i].category) 
              << setw(10) << drinks[i].price 
              << setw(10) << drinks[i].stock << "\n";
     }
@@ -549,8 +1100,8 @@ void removeDrink() {
             return;
         }
         
-        if (choice<1 || choice>totalEntries) {
-            cout<< "Invalid choice. Please select a number between 1 and " <<totalEntries<< ".\n";
+        if (choice<1 || choice>(int)drinks.size()) {
+            cout<< "Invalid choice. Please select a number between 1 and " <<drinks.size()<< ".\n";
         } else {
             break;
         }
@@ -568,13 +1119,10 @@ void removeDrink() {
         return;
     }
     
-    for (int i=choice-1; i<totalEntries-1; i++) {
-        drinks[i] =drinks[i+1];
-    }
-    
-    totalEntries--;
-    saveDataToFile();
-    saveSortedDataToFile();
+    removeFromSortedView(choice - 1);
+    drinks.erase(drinks.begin() + (choice - 1));
+    journalAppend('D', choice - 1, Drink());
+    commitJournal();
     
     cout << "Drink removed successfully!\n";
     waitForEnter();
@@ -583,90 +1131,123 @@ void removeDrink() {
 void sortAndSaveDrinks() {
     displayHeader("Sort and Save Drinks");
     
-    Drink sorted[MAX_ENTRIES];
-    
-    int categoryCount[MAX_CATEGORIES] = {0};
-    for (int i=0; i<totalEntries; i++) {
-        for (int j=0; j<totalCategories; j++) {
-            if (drinks[i].category == categories[j]) {
-                categoryCount[j]++;
-                break;
-            }
-        }
+    const vector<int>& order = sortedView;
+    if (!writeFileAtomically("sorted_information.txt", formatDrinks(drinks.data(), order))) {
+        cout<< "Cannot save to sorted_information.txt\n";
+        waitForEnter();
+        return;
     }
+    sortedFileWritten();
+
+    cout << "Drinks have been sorted and saved to sorted_information.txt\n";
+    cout << "Sorted order:\n";
+    cout <<left<<setw(20)<< "Name" <<setw(15) << "Category" 
+         <<setw(10) << "Price" <<setw(10) << "Stock" << "\n";
+    cout <<string(55, '-') << "\n";
     
-    int categoryIndex[MAX_CATEGORIES] = {0};
-    for (int i = 1; i < totalCategories; i++) {
-        categoryIndex[i] = categoryIndex[i-1] + categoryCount[i-1];
+    for (size_t i = 0; i < order.size(); i++) {
+        const Drink& drink = drinks[order[i]];
+        cout <<left <<setw(20) <<drink.name 
+             <<setw(15) <<categoryName(drink.category) 
+             <<setw(10) <<drink.price 
+             <<setw(10) <<drink.stock << "\n";
     }
     
-    Stack categoryStacks[MAX_CATEGORIES];
-    for (int i=0;i<totalEntries;i++) {
-        for (int j=0; j<totalCategories; j++) {
-            if (drinks[i].category == categories[j]) {
-                categoryStacks[j].push(drinks[i]);
+    waitForEnter();
+}
+
+// The old sort, kept for the benchmark: push every drink onto a stack per category,
+// pop each stack into a temporary array, insertion sort it by name, then copy it into
+// tempSorted and again into sorted. Uses vectors in place of the old fixed 50-entry arrays.
+vector<Drink> legacySortDrinks(const vector<Drink>& list) {
+    int totalCategories = categoryOrder.size();
+    vector<vector<Drink> > categoryStacks(totalCategories);
+    for (size_t i = 0; i < list.size(); i++) {
+        for (int j = 0; j < totalCategories; j++) {
+            if (list[i].category == categoryOrder[j]) {
+                categoryStacks[j].push_back(list[i]);
                 break;
             }
         }
     }
-    
-    Drink tempSorted[MAX_ENTRIES];
-    int currentIndex = 0;
+
+    vector<Drink> tempSorted;
     for (int cat = 0; cat < totalCategories; cat++) {
-        Drink tempCategory[MAX_ENTRIES];
-        int tempCount = 0;
-        while (!categoryStacks[cat].isEmpty()) {
-            tempCategory[tempCount++] = categoryStacks[cat].pop();
+        vector<Drink> tempCategory;
+        while (!categoryStacks[cat].empty()) {
+            tempCategory.push_back(categoryStacks[cat].back());
+            categoryStacks[cat].pop_back();
         }
-        
-        for (int i=1;i<tempCount;i++) {
+        for (size_t i = 1; i < tempCategory.size(); i++) {
             Drink key = tempCategory[i];
-            int j=i - 1;
-            while (j>=0 && tempCategory[j].name > key.name) {
+            int j = (int)i - 1;
+            while (j >= 0 && tempCategory[j].name > key.name) {
                 tempCategory[j+1] = tempCategory[j];
                 j--;
             }
             tempCategory[j+1] = key;
         }
-        
-        for (int i=0;i<tempCount;i++) {
-            tempSorted[currentIndex++] = tempCategory[i];
+        for (size_t i = 0; i < tempCategory.size(); i++) {
+            tempSorted.push_back(tempCategory[i]);
         }
     }
-    
-    for (int i=0;i<totalEntries;i++) {
+
+    vector<Drink> sorted(tempSorted.size());
+    for (size_t i = 0; i < tempSorted.size(); i++) {
         sorted[i] = tempSorted[i];
     }
+    return sorted;
+}
 
-    ofstream file("sorted_information.txt");
-    if (!file.is_open()) {
-        cout<< "Cannot save to sorted_information.txt\n";
-        waitForEnter();
-        return;
-    }
+// Times the old stack + insertion sort pipeline against sortedDrinkOrder on 50, 10K and
+// 1M random drinks and checks both give the same order. The old sort is quadratic, so
+// above 10K drinks its time is only estimated from the 10K run.
+void runSortBenchmark() {
+    const int sizes[] = {50, 10000, 1000000};
+    mt19937 rng(2024);
+    double legacyPerPair = 0;   // Legacy ms divided by n*n at the last size it was run on
 
-    for (int i = 0; i < totalEntries; i++) {
-        file <<sorted[i].name<< " " 
-             <<sorted[i].category<< " " 
-             <<sorted[i].price<< " " 
-             <<sorted[i].stock<< "\n";
-    }
-    file.close();
+    int totalCategories = categoryOrder.size();
+    cout << "Sort benchmark (" << totalCategories << " categories)\n";
+    cout << string(76, '-') << "\n";
+    cout << left << setw(12) << "Drinks" << setw(22) << "Stack+insertion (ms)" << setw(22) << "sortedDrinkOrder (ms)"
+         << setw(12) << "Speedup" << "Same order" << "\n";
+    cout << string(76, '-') << "\n";
+    for (int s = 0; s < 3; s++) {
+        int n = sizes[s];
+        vector<Drink> list(n);
+        for (int i = 0; i < n; i++) {
+            list[i].name = "Drink" + to_string(rng() % (10 * n));
+            list[i].category = categoryOrder[rng() % totalCategories];
+            list[i].price = 3 + rng() % 10;
+            list[i].stock = rng() % 200;
+        }
 
-    cout << "Drinks have been sorted and saved to sorted_information.txt\n";
-    cout << "Sorted order:\n";
-    cout <<left<<setw(20)<< "Name" <<setw(15) << "Category" 
-         <<setw(10) << "Price" <<setw(10) << "Stock" << "\n";
-    cout <<string(55, '-') << "\n";
-    
-    for (int i = 0; i < totalEntries; i++) {
-        cout <<left <<setw(20) <<sorted[i].name 
-             <<setw(15) <<sorted[i].category 
-             <<setw(10) <<sorted[i].price 
-             <<setw(10) <<sorted[i].stock << "\n";
+        auto t0 = chrono::steady_clock::now();
+        vector<int> order = sortedDrinkOrder(list.data(), n);
+        double newMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+        cout << left << setw(12) << n << fixed << setprecision(2);
+        if (n <= 10000) {
+            t0 = chrono::steady_clock::now();
+            vector<Drink> sorted = legacySortDrinks(list);
+            double legacyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            legacyPerPair = legacyMs / ((double)n * n);
+
+            bool same = sorted.size() == order.size();
+            for (size_t i = 0; same && i < order.size(); i++) {
+                same = sorted[i].name == list[order[i]].name && sorted[i].category == list[order[i]].category;
+            }
+            cout << setw(22) << legacyMs << setw(22) << newMs << setw(12) << legacyMs / newMs
+                 << (same ? "yes" : "NO") << "\n";
+        } else {
+            double estimateMs = legacyPerPair * n * n;
+            cout << setw(22) << ("~" + to_string((long long)estimateMs) + " (est.)") << setw(22) << newMs
+                 << setw(12) << estimateMs / newMs << "-" << "\n";
+        }
+        cout.unsetf(ios::fixed);
     }
-    
-    waitForEnter();
+    cout << string(76, '-') << "\n";
 }
 
 void mainMenu() {
@@ -711,6 +1292,8 @@ void mainMenu() {
                 removeDrink();
                 break;
             case 8: 
+                compactJournal();
+                flushSortedFile();
                 return;
             default:
                 cout << "Invalid choice. Try again.\n";
@@ -719,9 +1302,426 @@ void mainMenu() {
     }
 }
 
-int main() {
+// Latency of one search (category range + name lookup) when every search reloads the
+// sorted file, as before, versus going through SortedCache. Ends by rewriting the file
+// to check that the cache notices and reloads it.
+void runSearchBenchmark() {
+    const int sizes[] = {50, 10000, 100000};
+    const string path = "bench_sorted.txt";
+    int totalCategories = categoryOrder.size();
+    mt19937 rng(7);
+
+    cout << "Search latency benchmark\n";
+    cout << string(92, '-') << "\n";
+    cout << left << setw(10) << "Drinks" << setw(10) << "Searches" << setw(18) << "Reload mean (us)"
+         << setw(18) << "Reload p99 (us)" << setw(18) << "Cached mean (us)" << setw(18) << "Cached p99 (us)" << "\n";
+    cout << string(92, '-') << "\n";
+    for (int s = 0; s < 3; s++) {
+        int n = sizes[s];
+        int searches = n <= 10000 ? 1000 : 50;
+        ostringstream text;
+        char name[24];
+        for (int cat = 0; cat < totalCategories; cat++) {
+            for (int i = cat; i < n; i += totalCategories) {
+                snprintf(name, sizeof(name), "Drink%07d", i);
+                text << name << " " << categoryName(categoryOrder[cat]) << " " << 5 + i % 20 << " " << i % 300 << "\n";
+            }
+        }
+        writeFileAtomically(path, text.str());
+        SortedCache cache(path);
+        cache.get();    // Time the steady state, the first search pays for one parse
+
+        vector<double> times[2];
+        int found = 0;
+        for (int q = 0; q < searches; q++) {
+            int i = rng() % n;
+            snprintf(name, sizeof(name), "Drink%07d", i);
+            int category = categoryOrder[i % totalCategories];
+            for (int cached = 0; cached < 2; cached++) {
+                auto t0 = chrono::steady_clock::now();
+                bool hit;
+                if (cached) {
+                    cache.get();
+                    hit = cache.findName(category, name) != -1;
+                } else {
+                    int size;
+                    Drink* legacy = legacyLoadSortedDrinks(path, size);
+                    int start, end;
+                    hit = categoryRange(legacy, size, category, start, end) && ternarySearch(legacy, start, end, name) != -1;
+                    delete[] legacy;
+                }
+                if (hit) {
+                    found++;
+                }
+                times[cached].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count());
+            }
+        }
+
+        cout << left << setw(10) << n << setw(10) << searches << fixed << setprecision(1);
+        for (int cached = 0; cached < 2; cached++) {
+            vector<double>& t = times[cached];
+            double total = 0;
+            for (size_t k = 0; k < t.size(); k++) {
+                total += t[k];
+            }
+            sort(t.begin(), t.end());
+            cout << setw(18) << total / t.size() << setw(18) << t[t.size() * 99 / 100];
+        }
+        cout << (found == 2 * searches ? "" : "  (lookups FAILED)") << "\n";
+        cout.unsetf(ios::fixed);
+
+        if (s == 2) {
+            text << "Zzz " << categoryName(categoryOrder[0]) << " 1 1\n";
+            writeFileAtomically(path, text.str());
+            size_t rows = cache.get().size();
+            cout << string(92, '-') << "\n";
+            cout << "Cache parsed the file " << cache.reloads << " times; after a rewrite it has " << rows
+                 << " rows (expected " << n + 1 << ")\n";
+        }
+    }
+    remove(path.c_str());
+}
+
+// Nanoseconds per lookup (category, then name) in a sorted catalog of n drinks: the old two
+// binary searches plus recursive ternary search, versus the SortedCache directory and
+// name trees. One lookup in ten is for a name that is not there. Both must agree.
+void runLookupBenchmark(int n) {
+    const int lookups = 1000000;
+    int totalCategories = categoryOrder.size();
+    mt19937 rng(18);
+    vector<Drink> list(n);
+    for (int i = 0; i < n; i++) {
+        list[i].name = "Drink" + to_string(rng() % (10 * n));
+        list[i].category = categoryOrder[rng() % totalCategories];
+        list[i].price = 3 + rng() % 10;
+        list[i].stock = rng() % 200;
+    }
+    SortedCache cache("");
+    vector<int> order = sortedDrinkOrder(list.data(), n);
+    for (size_t i = 0; i < order.size(); i++) {
+        cache.rows.push_back(list[order[i]]);
+    }
+    auto t0 = chrono::steady_clock::now();
+    cache.buildDirectory();
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+    vector<pair<int, string> > queries(lookups);
+    for (int q = 0; q < lookups; q++) {
+        const Drink& drink = cache.rows[rng() % n];
+        queries[q] = make_pair(drink.category, q % 10 == 0 ? drink.name + "x" : drink.name);
+    }
+
+    const Drink* sorted = cache.rows.data();
+    vector<int> results[2];
+    double ns[2];
+    for (int method = 0; method < 2; method++) {
+        results[method].resize(lookups);
+        t0 = chrono::steady_clock::now();
+        for (int q = 0; q < lookups; q++) {
+            int category = queries[q].first;
+            const string& name = queries[q].second;
+            if (method == 0) {
+                int start, end;
+                results[0][q] = categoryRange(sorted, n, category, start, end) ? ternarySearch(sorted, start, end, name) : -1;
+            } else {
+                results[1][q] = cache.findName(category, name);
+            }
+        }
+        ns[method] = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / lookups;
+    }
+
+    bool same = true;
+    for (int q = 0; q < lookups && same; q++) {
+        int a = results[0][q];
+        int b = results[1][q];
+        same = (a == -1) == (b == -1) && (a == -1 || sorted[a].name == sorted[b].name);
+    }
+    cout << "Lookup benchmark: " << n << " drinks, " << totalCategories << " categories, " << lookups << " lookups\n";
+    cout << string(60, '-') << "\n";
+    cout << fixed << setprecision(1);
+    cout << left << setw(40) << "Binary searches + ternary search" << ns[0] << " ns\n";
+    cout << left << setw(40) << "Directory + Eytzinger name tree" << ns[1] << " ns\n";
+    cout << string(60, '-') << "\n";
+    cout << "Speedup " << setprecision(2) << ns[0] / ns[1] << "x, directory built in " << setprecision(1) << buildMs
+         << " ms, results " << (same ? "match" : "DIFFER") << "\n";
+    cout.unsetf(ios::fixed);
+}
+
+// Loads a generated catalog far beyond the old 50 drink / 10 category limits, then adds
+// and removes drinks through the sorted view and checks that nothing was lost or misordered
+void runStressTest(int n, int extraCategories) {
+    const string path = "stress_mixue.txt";
+    mt19937 rng(11);
+    auto elapsedMs = [](chrono::steady_clock::time_point t0) {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    };
+
+    ostringstream text;
+    char category[24];
+    for (int i = 0; i < n; i++) {
+        snprintf(category, sizeof(category), "Category%05d", (int)(rng() % extraCategories));
+        text << "Drink" << i << " " << category << " " << 5 + rng() % 20 << " " << rng() % 300 << "\n";
+    }
+    writeFileAtomically(path, text.str());
+    text.str("");
+
+    cout << "Stress test: " << n << " drinks in " << extraCategories << " generated categories\n";
+    auto t0 = chrono::steady_clock::now();
+    readDataFromFile(path);
+    double loadMs = elapsedMs(t0);
+    bool ok = (int)drinks.size() == n;
+    cout << "  load:           " << fixed << setprecision(1) << loadMs << " ms, " << drinks.size() << " drinks, "
+         << categoryNames.size() << " categories" << (ok ? "" : "  (drinks LOST)") << "\n";
+
+    t0 = chrono::steady_clock::now();
+    sortedView = sortedDrinkOrder(drinks.data(), drinks.size());
+    cout << "  sort:           " << elapsedMs(t0) << " ms\n";
+
+    const int changes = 10000;
+    t0 = chrono::steady_clock::now();
+    for (int i = 0; i < changes; i++) {
+        Drink drink;
+        drink.name = "Added" + to_string(i);
+        drink.category = rng() % categoryNames.size();
+        drink.price = 10;
+        drink.stock = 1;
+        drinks.push_back(drink);
+        indexDrink(drinks.size() - 1);
+    }
+    cout << "  " << changes << " adds:     " << elapsedMs(t0) << " ms\n";
+
+    const int removes = 100;
+    t0 = chrono::steady_clock::now();
+    for (int i = 0; i < removes; i++) {
+        int index = rng() % drinks.size();
+        removeFromSortedView(index);
+        drinks.erase(drinks.begin() + index);
+    }
+    cout << "  " << removes << " removes:    " << elapsedMs(t0) << " ms\n";
+
+    ok = ok && (int)drinks.size() == n + changes - removes && sortedView.size() == drinks.size();
+    vector<bool> seen(drinks.size(), false);
+    for (size_t i = 0; ok && i < sortedView.size(); i++) {
+        ok = sortedView[i] >= 0 && sortedView[i] < (int)drinks.size() && !seen[sortedView[i]]
+             && (i == 0 || sortedBefore(sortedView[i-1], sortedView[i]));
+        if (ok) {
+            seen[sortedView[i]] = true;
+        }
+    }
+    cout << "  sorted view:    " << (ok ? "complete and in order" : "BROKEN") << "\n";
+    cout.unsetf(ios::fixed);
+    remove(path.c_str());
+}
+
+// Heap bytes a string owns on top of sizeof(string): none while it fits the small-string buffer
+size_t stringHeapBytes(const string& s) {
+    const char* inside = (const char*)&s;
+    if (s.data() >= inside && s.data() < inside + sizeof(s)) {
+        return 0;
+    }
+    return s.capacity() + 1;
+}
+
+// Memory taken by n drinks when every drink holds its category as a string, as before,
+// and with category IDs. Categories are the three defaults plus one longer name that does
+// not fit in a string's small buffer.
+void runMemoryReport(int n) {
+    struct StringCategoryDrink {    // Drink before the category dictionary
+        string name;
+        string category;
+        int price;
+        int stock;
+    };
+    const char* names[] = {"Beverage", "Juice", "Tea", "SeasonalSpecials"};
+    int ids[4];
+    for (int c = 0; c < 4; c++) {
+        ids[c] = internCategory(names[c]);
+    }
+
+    vector<StringCategoryDrink> before(n);
+    vector<Drink> after(n);
+    for (int i = 0; i < n; i++) {
+        string name = "Drink" + to_string(i);
+        before[i].name = name;
+        before[i].category = names[i % 4];
+        before[i].price = after[i].price = 5 + i % 20;
+        before[i].stock = after[i].stock = i % 300;
+        after[i].name = name;
+        after[i].category = ids[i % 4];
+    }
+
+    size_t nameBytes = 0;
+    size_t categoryBytes = 0;
+    for (int i = 0; i < n; i++) {
+        nameBytes += stringHeapBytes(before[i].name);
+        categoryBytes += stringHeapBytes(before[i].category);
+    }
+    size_t dictionaryBytes = categoryNames.capacity() * sizeof(string)
+                             + (categoryOrder.capacity() + categoryRanks.capacity()) * sizeof(int);
+    for (size_t c = 0; c < categoryNames.size(); c++) {
+        dictionaryBytes += stringHeapBytes(categoryNames[c]);
+    }
+    size_t beforeTotal = before.capacity() * sizeof(StringCategoryDrink) + nameBytes + categoryBytes;
+    size_t afterTotal = after.capacity() * sizeof(Drink) + nameBytes + dictionaryBytes;
+    const double MB = 1024.0 * 1024.0;
+
+    cout << "Memory footprint of " << n << " drinks, " << categoryNames.size() << " categories\n";
+    cout << string(62, '-') << "\n";
+    cout << left << setw(30) << "" << setw(16) << "String category" << setw(16) << "Category ID" << "\n";
+    cout << string(62, '-') << "\n";
+    cout << fixed << setprecision(1);
+    cout << setw(30) << "Drink struct (bytes)" << setw(16) << sizeof(StringCategoryDrink) << setw(16) << sizeof(Drink) << "\n";
+    cout << setw(30) << "Drink array (MB)" << setw(16) << before.capacity() * sizeof(StringCategoryDrink) / MB
+         << setw(16) << after.capacity() * sizeof(Drink) / MB << "\n";
+    cout << setw(30) << "Name heap (MB)" << setw(16) << nameBytes / MB << setw(16) << nameBytes / MB << "\n";
+    cout << setw(30) << "Category heap (MB)" << setw(16) << categoryBytes / MB << setw(16) << dictionaryBytes / MB << "\n";
+    cout << setw(30) << "Total (MB)" << setw(16) << beforeTotal / MB << setw(16) << afterTotal / MB << "\n";
+    cout << setw(30) << "Bytes per drink" << setw(16) << (double)beforeTotal / n << setw(16) << (double)afterTotal / n << "\n";
+    cout << string(62, '-') << "\n";
+    cout << 100.0 * (beforeTotal - afterTotal) / beforeTotal << "% less memory\n";
+    cout.unsetf(ios::fixed);
+}
+
+#ifndef MIXUE_LIBRARY
+int main(int argc, char* argv[]) {
     initializeCategories();
+    if (argc > 1 && string(argv[1]) == "--bench-sort") {
+        runSortBenchmark();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-search") {
+        runSearchBenchmark();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-lookup") {
+        runLookupBenchmark(argc > 2 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--memory-report") {
+        runMemoryReport(argc > 2 ? atoi(argv[2]) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--stress") {
+        runStressTest(argc > 2 ? atoi(argv[2]) : 1000000, argc > 3 ? atoi(argv[3]) : 10000);
+        return 0;
+    }
     readDataFromFile();
+    replayJournal();
+    sortedView = sortedDrinkOrder(drinks.data(), drinks.size());
+    sortedFileStale = true;     // A crash may have left sorted_information.txt behind drinks[]
     mainMenu();
     return 0;
 }
+#endif
+
+#ifdef MIXUE_LIBRARY
+}   // namespace array_catalog
+
+// The sorted array behind the benchmark's interface (catalog_bench.h). The catalog lives in
+// the globals above, so only one of these can be in use at a time. Nothing is journaled:
+// the journal is never opened.
+class ArrayCatalog : public BenchCatalog {
+private:
+    array_catalog::SortedCache cache;   // Filled from sortedView, as if sorted_information.txt had just been read
+
+    // The cache, filled again first if insert or remove has changed sortedView since
+    const array_catalog::SortedCache& current() {
+        using namespace array_catalog;
+        if (sortedCacheStale) {
+            cache.fill(drinks.data(), sortedView);
+            sortedCacheStale = false;
+        }
+        return cache;
+    }
+
+public:
+    ArrayCatalog() : cache("") {
+        array_catalog::categoryNames.clear();
+        array_catalog::categoryOrder.clear();
+        array_catalog::categoryRanks.clear();
+        array_catalog::initializeCategories();
+        array_catalog::drinks.clear();
+        array_catalog::sortedView.clear();
+        array_catalog::sortedCacheStale = true;
+    }
+
+    const char* name() const {
+        return "sorted_array";
+    }
+
+    bool load(const std::string& path) {
+        using namespace array_catalog;
+        readDataFromFile(path);
+        sortedView = sortedDrinkOrder(drinks.data(), drinks.size());
+        sortedCacheStale = true;
+        current();
+        return !drinks.empty();
+    }
+
+    bool lookup(const std::string& name, const std::string& type) {
+        return current().findName(array_catalog::findCategory(type), name) != -1;
+    }
+
+    size_t listType(const std::string& type, long long& stock) {
+        const array_catalog::SortedCache& sorted = current();
+        int start, end;
+        if (!sorted.categoryRows(array_catalog::findCategory(type), start, end)) {
+            return 0;
+        }
+        for (int row = start; row <= end; row++) {
+            stock += sorted.rows[row].stock;
+        }
+        return end - start + 1;
+    }
+
+    size_t sortDrinks() {
+        return array_catalog::sortedDrinkOrder(array_catalog::drinks.data(), array_catalog::drinks.size()).size();
+    }
+
+    // Like addNewDrinks: append, then put it in its place in the sorted view
+    bool insert(const BenchDrink& d) {
+        using namespace array_catalog;
+        Drink drink;
+        drink.name = d.name;
+        drink.category = internCategory(d.type);
+        drink.price = d.price;
+        drink.stock = d.stock;
+        drinks.push_back(drink);
+        indexDrink(drinks.size() - 1);
+        return true;
+    }
+
+    // Like removeDrink, with the drink found by a binary search of the sorted view
+    bool remove(const std::string& name, const std::string& type) {
+        using namespace array_catalog;
+        int category = findCategory(type);
+        if (category < 0) {
+            return false;
+        }
+        int rank = categoryRanks[category];
+        vector<int>::iterator pos = lower_bound(sortedView.begin(), sortedView.end(), 0, [&](int index, int) {
+            int r = categoryRanks[drinks[index].category];
+            return r != rank ? r < rank : drinks[index].name < name;
+        });
+        if (pos == sortedView.end() || drinks[*pos].category != category || drinks[*pos].name != name) {
+            return false;
+        }
+        int index = *pos;
+        removeFromSortedView(index);
+        drinks.erase(drinks.begin() + index);
+        return true;
+    }
+
+    bool save(const std::string& path) {
+        return array_catalog::saveDataToFile(path);
+    }
+
+    size_t size() const {
+        return array_catalog::drinks.size();
+    }
+};
+
+BenchCatalog* newArrayCatalog() {
+    return new ArrayCatalog();
+}
+#endif
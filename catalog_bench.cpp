@@ -0,0 +1,263 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdio>    // For remove
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include "catalog_bench.h"
+
+// Runs both catalog implementations over the same generated catalogs and prints ns per
+// operation side by side, plus a JSON file with every result for tracking regressions:
+//   catalog_bench [--max DRINKS] [--json FILE]
+// Catalogs have 10 to 10M drinks (--max stops earlier) with two kinds of names:
+//   uniform   random names, types and lookups all spread evenly
+//   skewed    names built from a few common words so many share long prefixes, most drinks
+//             in a few types, and lookups that keep coming back to the same hot drinks (Zipf)
+
+using namespace std;
+
+const size_t SIZES[] = {10, 1000, 100000, 1000000, 10000000};
+const size_t LOOKUPS = 1000000;     // Point lookups per catalog, one in ten for a name that is not there
+const size_t LISTING_VISITS = 20000000;   // Roughly how many drinks the type listings visit in total
+const char* const TYPES[] = {"Tea", "Juice", "Beverage", "Coffee", "Smoothie", "Yogurt", "Slush", "Soda", "Latte", "Frappe",
+                             "Cocoa", "Lemonade", "Sundae", "Cone", "Shake", "Milk", "Punch", "Tonic", "Float", "Brew"};
+const size_t TYPE_COUNT = sizeof(TYPES) / sizeof(TYPES[0]);
+const char* const WORDS[] = {"Taro", "Mango", "Lemon", "Peach", "Boba", "Matcha", "Grape", "Oolong",
+                             "Jasmine", "Coconut", "Berry", "Passion", "Honey", "Brown", "Pearl", "Cheese"};
+const size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+const char* const INPUT_FILE = "catalog_bench_input.txt";
+const char* const SAVED_FILE = "catalog_bench_saved.txt";
+
+struct BenchResult {
+    string implementation;
+    string names;
+    size_t drinks;
+    string operation;
+    size_t ops;
+    double nsPerOp;
+    bool ok;    // The catalog gave the answers it should have
+};
+
+// Index in [0, n) where index k comes up about 1/(k+1) as often as index 0
+size_t zipfIndex(mt19937_64& rng, size_t n) {
+    double u = uniform_real_distribution<double>(0, 1)(rng);
+    return min(n - 1, (size_t)pow((double)n + 1, u) - 1);
+}
+
+// Base 36 serial number, which keeps every generated name unique
+string serial(size_t i) {
+    string s;
+    do {
+        s += "0123456789abcdefghijklmnopqrstuvwxyz"[i % 36];
+        i /= 36;
+    } while (i > 0);
+    return s;
+}
+
+BenchDrink makeDrink(mt19937_64& rng, size_t i, bool skewed) {
+    BenchDrink d;
+    if (skewed) {
+        d.name = string(WORDS[zipfIndex(rng, WORD_COUNT)]) + WORDS[zipfIndex(rng, WORD_COUNT)] + serial(i);
+        d.type = TYPES[zipfIndex(rng, TYPE_COUNT)];
+    } else {
+        d.name = string(1, (char)('A' + rng() % 26));
+        for (int k = 0; k < 5; k++) {
+            d.name += (char)('a' + rng() % 26);
+        }
+        d.name += serial(i);
+        d.type = TYPES[rng() % TYPE_COUNT];
+    }
+    d.price = 1 + rng() % 30;
+    d.stock = rng() % 500;
+    return d;
+}
+
+// Silences what the catalogs print while they are timed
+class QuietOutput {
+private:
+    streambuf* saved;
+
+public:
+    QuietOutput() : saved(cout.rdbuf(NULL)) {
+    }
+
+    ~QuietOutput() {
+        cout.rdbuf(saved);
+        cout.clear();
+    }
+};
+
+double elapsedNs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+// Times every operation on one catalog, appending a result for each
+void benchCatalog(BenchCatalog* catalog, const string& names, const vector<BenchDrink>& drinks,
+                  const vector<BenchDrink>& extra, const vector<BenchDrink>& queries, size_t hits, vector<BenchResult>& results) {
+    size_t n = drinks.size();
+    size_t reps = max((size_t)1, min((size_t)20, 100000 / n));   // Small catalogs load, sort and save more than once
+    auto add = [&](const string& operation, size_t ops, double ns, bool ok) {
+        BenchResult r = {catalog->name(), names, n, operation, ops, ns / ops, ok};
+        results.push_back(r);
+    };
+    QuietOutput quiet;
+
+    auto start = chrono::steady_clock::now();
+    bool ok = true;
+    for (size_t r = 0; r < reps; r++) {
+        ok = catalog->load(INPUT_FILE) && ok;
+    }
+    add("load", reps, elapsedNs(start), ok && catalog->size() == n);
+
+    size_t found = 0;
+    start = chrono::steady_clock::now();
+    for (size_t q = 0; q < queries.size(); q++) {
+        found += catalog->lookup(queries[q].name, queries[q].type);
+    }
+    add("lookup", queries.size(), elapsedNs(start), found == hits);
+
+    long long stock = 0;
+    size_t listed = 0;
+    for (size_t t = 0; t < TYPE_COUNT; t++) {
+        listed += catalog->listType(TYPES[t], stock);
+    }
+    size_t listings = max(TYPE_COUNT, min((size_t)10000, LISTING_VISITS / n));
+    start = chrono::steady_clock::now();
+    for (size_t l = 0; l < listings; l++) {
+        catalog->listType(TYPES[l % TYPE_COUNT], stock);
+    }
+    add("list_type", listings, elapsedNs(start), listed == n);
+
+    ok = true;
+    start = chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; r++) {
+        ok = catalog->sortDrinks() == n && ok;
+    }
+    add("sort", reps, elapsedNs(start), ok);
+
+    ok = true;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < extra.size(); i++) {
+        ok = catalog->insert(extra[i]) && ok;
+    }
+    add("insert", extra.size(), elapsedNs(start), ok && catalog->size() == n + extra.size());
+
+    ok = true;
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < extra.size(); i++) {
+        ok = catalog->remove(extra[i].name, extra[i].type) && ok;
+    }
+    add("remove", extra.size(), elapsedNs(start), ok && catalog->size() == n);
+
+    ok = true;
+    start = chrono::steady_clock::now();
+    for (size_t r = 0; r < reps; r++) {
+        ok = catalog->save(SAVED_FILE) && ok;
+    }
+    add("save", reps, elapsedNs(start), ok);
+}
+
+string jsonResults(const vector<BenchResult>& results) {
+    ostringstream out;
+    out << fixed << setprecision(1);
+    out << "{\n  \"benchmark\": \"catalog_bench\",\n  \"lookups\": " << LOOKUPS << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"implementation\": \"" << r.implementation << "\", \"names\": \"" << r.names
+            << "\", \"drinks\": " << r.drinks << ", \"operation\": \"" << r.operation << "\", \"ops\": " << r.ops
+            << ", \"ns_per_op\": " << r.nsPerOp << ", \"ok\": " << (r.ok ? "true" : "false") << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxDrinks = SIZES[sizeof(SIZES) / sizeof(SIZES[0]) - 1];
+    string jsonFile = "catalog_bench.json";
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--max" && i + 1 < argc) {
+            maxDrinks = strtoull(argv[++i], NULL, 10);
+        } else if (string(argv[i]) == "--json" && i + 1 < argc) {
+            jsonFile = argv[++i];
+        } else {
+            cout << "Usage: " << argv[0] << " [--max DRINKS] [--json FILE]\n";
+            return 1;
+        }
+    }
+
+    vector<BenchResult> results;
+    bool allOk = true;
+    cout << "Catalog benchmark, ns per operation (" << LOOKUPS << " lookups per catalog)\n";
+    cout << "-------------------------------------------------------------------------------------\n";
+    cout << "| Names    | Drinks     | Operation  | Ops        | hash_table     | sorted_array   |\n";
+    cout << "-------------------------------------------------------------------------------------\n";
+    for (int skewed = 0; skewed < 2; skewed++) {
+        string names = skewed ? "skewed" : "uniform";
+        for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]) && SIZES[s] <= maxDrinks; s++) {
+            size_t n = SIZES[s];
+            mt19937_64 rng(2025 + n);
+            vector<BenchDrink> drinks;
+            drinks.reserve(n);
+            {
+                ofstream file(INPUT_FILE);
+                for (size_t i = 0; i < n; i++) {
+                    drinks.push_back(makeDrink(rng, i, skewed));
+                    const BenchDrink& d = drinks.back();
+                    file << d.name << " " << d.type << " " << d.price << " " << d.stock << "\n";
+                }
+            }
+            // Inserting into the sorted array moves everything after the new drink, so the
+            // big catalogs take fewer inserts and removes
+            vector<BenchDrink> extra;
+            for (size_t i = 0; i < (n <= 100000 ? 1000 : n <= 1000000 ? 100 : 20); i++) {
+                extra.push_back(makeDrink(rng, n + i, skewed));
+            }
+            vector<BenchDrink> queries(LOOKUPS);
+            size_t hits = 0;
+            for (size_t q = 0; q < LOOKUPS; q++) {
+                queries[q] = drinks[skewed ? zipfIndex(rng, n) : rng() % n];
+                if (q % 10 == 0) {
+                    queries[q].name += "_";     // Generated names never have one
+                } else {
+                    hits++;
+                }
+            }
+
+            size_t first = results.size();
+            BenchCatalog* catalogs[2] = {newHashCatalog(), newArrayCatalog()};
+            for (int c = 0; c < 2; c++) {
+                benchCatalog(catalogs[c], names, drinks, extra, queries, hits, results);
+                delete catalogs[c];
+            }
+            size_t perCatalog = (results.size() - first) / 2;
+            for (size_t k = first; k < first + perCatalog; k++) {
+                const BenchResult& h = results[k];
+                const BenchResult& a = results[k + perCatalog];
+                cout << "| " << left << setw(9) << names << "| " << setw(11) << n << "| " << setw(11) << h.operation
+                     << "| " << setw(11) << h.ops << fixed << setprecision(1)
+                     << "| " << setw(15) << h.nsPerOp << "| " << setw(15) << a.nsPerOp << "|"
+                     << (h.ok ? "" : "  hash_table WRONG") << (a.ok ? "" : "  sorted_array WRONG") << "\n";
+                cout.unsetf(ios::fixed);
+                allOk = allOk && h.ok && a.ok;
+            }
+        }
+    }
+    cout << "-------------------------------------------------------------------------------------\n";
+    remove(INPUT_FILE);
+    remove(SAVED_FILE);
+
+    ofstream json(jsonFile.c_str());
+    json << jsonResults(results);
+    if (!json) {
+        cout << "Cannot write " << jsonFile << "\n";
+        return 1;
+    }
+    cout << "Results written to " << jsonFile << "\n";
+    return allOk ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#ifndef CATALOG_BENCH_H
+#define CATALOG_BENCH_H
+
+#include <cstddef>
+#include <string>
+
+// What catalog_bench.cpp needs from a catalog. mixue.cpp (the hash table) and
+// Mixue Group B.cpp (the sorted array) each provide one when built with MIXUE_LIBRARY.
+
+// One line of a catalog file: "name type price stock"
+struct BenchDrink {
+    std::string name;
+    std::string type;
+    int price;
+    int stock;
+};
+
+class BenchCatalog {
+public:
+    virtual ~BenchCatalog() {}
+
+    virtual const char* name() const = 0;
+
+    // Replaces the catalog with the drinks in a catalog file. Once it returns, the catalog is
+    // ready to answer lookups. False if the file held no drinks.
+    virtual bool load(const std::string& path) = 0;
+
+    // Whether the catalog has a drink with this name. The type is the drink's own type:
+    // the sorted array looks drinks up within their category.
+    virtual bool lookup(const std::string& name, const std::string& type) = 0;
+
+    // Visits every drink of one type, adding its stock to stock. Returns how many there are.
+    virtual size_t listType(const std::string& type, long long& stock) = 0;
+
+    // Puts every drink in order by type and then name. Returns how many were ordered.
+    virtual size_t sortDrinks() = 0;
+
+    virtual bool insert(const BenchDrink& drink) = 0;
+    virtual bool remove(const std::string& name, const std::string& type) = 0;
+
+    // Writes the catalog to a catalog file
+    virtual bool save(const std::string& path) = 0;
+
+    virtual size_t size() const = 0;
+};
+
+BenchCatalog* newHashCatalog();     // mixue.cpp
+BenchCatalog* newArrayCatalog();    // Mixue Group B.cpp
+
+#endif
@@ -4,27 +4,246 @@
 #include <limits>    // To help check user inputs are valid
 #include <cctype>    // For character functions (like tolower)
 #include <iomanip>  // For formatting output (like setw)
+#include <cstdint>   // For fixed width hash values (uint64_t)
+#include <chrono>    // For timing the benchmarks
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>   // For memcpy
+#include <cstdlib>   // For malloc and free
+#include <cmath>
+#include <new>
+#include <atomic>
+#include <string_view>
+#include <charconv>  // For from_chars (fast number parsing)
+#include <thread>
+#include <cstdio>    // For remove and rename
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <shared_mutex>
+#include <sstream>
+#include <sys/stat.h>
+#include <fcntl.h>     // For open and its O_ flags
+#ifndef _WIN32
+#include <sys/mman.h>  // For mmap
+#include <unistd.h>
+#include <signal.h>    // For the save torture test (kill)
+#include <sys/wait.h>
+#else
+#include <io.h>        // open/write/close on Windows
+#define fsync _commit
+#define ftruncate _chsize
+#endif
+#ifdef __linux__
+#define HAVE_CATALOG_SERVICE   // --serve and --load-test, built on epoll
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>   // For TCP_NODELAY
+#include <arpa/inet.h>
+#include <cerrno>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_KERNELS   // SSE2/AVX2 scan kernels, picked at run time by what the CPU supports
+#include <immintrin.h>
+#endif
+#ifdef MIXUE_LIBRARY
+#include "catalog_bench.h"
+#endif
 
 
 using namespace std;
 
-const int TABLE_SIZE = 50;  // Size of hash table, determines how many slots the hash table has 
+// Built with MIXUE_LIBRARY (the mixue_catalog library in CMakeLists.txt) there is no main, and
+// everything below is kept in its own namespace so it can be linked next to Mixue Group B.cpp
+#ifdef MIXUE_LIBRARY
+namespace hash_catalog {
+#endif
 
-struct Drink{
-	string name;
-	string type;
-	double price;     
-    int stock;        
-    Drink* next;   // Pointer to next drink in the chain (linked list), used to handle collisions
-	
-	Drink(const string& n, const string& t, double p, int s) {
-        name = n;
-        type = t;
-        price = p;
-        stock = s;
-        next = NULL;
+const size_t INITIAL_CAPACITY = 64;   // Starting number of slots, must be a power of two
+const double MAX_LOAD_FACTOR = 0.7;   // Table grows (doubles) once it is this full
+const size_t FIRST_ARENA_BLOCK = 4096;            // Size of the first arena block in bytes
+const size_t MAX_ARENA_BLOCK = 16 * 1024 * 1024;  // Arena blocks stop doubling at this size
+const size_t PARALLEL_LOAD_MIN_BYTES = 1024 * 1024;  // Smaller files are loaded on one thread
+const size_t JOURNAL_BATCH = 64;                     // Pending journal records that force a write + fsync
+const int JOURNAL_SYNC_MS = 50;                      // Otherwise pending records are synced this often
+const size_t JOURNAL_COMPACT_BYTES = 4 * 1024 * 1024;  // Journal size that triggers a background compaction
+const char SNAPSHOT_MAGIC[8] = {'M', 'I', 'X', 'U', 'E', 'B', 'I', 'N'};
+const uint32_t SNAPSHOT_VERSION = 1;   // Bump whenever the snapshot layout or nameHash changes
+const size_t NAME_BLOCK = 1024;        // A block of the sorted name index is split in two past this many names
+const uint32_t LOADING_ROW = UINT32_MAX;   // Drink::row of a drink a parallel load created but has not linked yet
+const size_t LOCK_STRIPES = 16;            // Independently locked parts of a ConcurrentHashTable, a power of two
+const size_t SERVICE_MAX_FRAME = 1 << 20;          // Longest request the service accepts, in bytes
+const size_t SERVICE_OUTPUT_LIMIT = 4 * 1024 * 1024;  // Unsent response bytes at which a connection stops being read
+
+// Built with MIXUE_COUNT_ALLOCS (the mixue_bench target in CMakeLists.txt), every heap
+// allocation made through operator new is counted, so the benchmarks can check that lookups
+// do not allocate. Every other build keeps the standard allocator and counts nothing.
+atomic<size_t> heapAllocations(0);
+
+#ifdef MIXUE_COUNT_ALLOCS
+const bool COUNTING_ALLOCATIONS = true;
+
+void* operator new(size_t size) {
+    heapAllocations.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (p == NULL) {
+        throw bad_alloc();
     }
-}; 
+    return p;
+}
+
+// GCC sees the free below inlined next to a call of the operator new above and reports a
+// malloc/delete mismatch; they are a matching pair
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+#else
+const bool COUNTING_ALLOCATIONS = false;
+#endif
+
+// An allocation count as a benchmark table shows it, "-" in a build that does not count them
+string allocationCell(double allocations, int decimals) {
+    if (!COUNTING_ALLOCATIONS) {
+        return "-";
+    }
+    ostringstream out;
+    out << fixed << setprecision(decimals) << allocations;
+    return out.str();
+}
+
+// Latency histogram in the HDR style: each power of two of nanoseconds is split into 16
+// linear sub-buckets, so a recorded value is known to within 1/16 (6%) from a fixed array
+// of counters, up to 2^40 ns (18 minutes). Counters are relaxed atomics, the concurrent
+// tables record from many threads at once.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB = 1 << SUB_BITS;
+    static constexpr int MAX_EXPONENT = 40;
+    static constexpr int BUCKETS = (MAX_EXPONENT - SUB_BITS + 2) * SUB;
+    atomic<uint64_t> counts[BUCKETS];
+    atomic<uint64_t> sum;
+    atomic<uint64_t> largest;
+    
+    static int bucketOf(uint64_t ns) {
+        if (ns < (uint64_t)SUB) {
+            return (int)ns;
+        }
+        int exponent = min(63 - __builtin_clzll(ns), MAX_EXPONENT);
+        int shift = exponent - SUB_BITS;
+        return (shift + 1) * SUB + (int)((ns >> shift) & (SUB - 1));
+    }
+    
+public:
+    // Largest value that lands in bucket b
+    static uint64_t bucketTop(int b) {
+        if (b < SUB) {
+            return b;
+        }
+        int shift = b / SUB - 1;
+        return ((uint64_t)(SUB + b % SUB + 1) << shift) - 1;
+    }
+    
+    static int bucketCount() {
+        return BUCKETS;
+    }
+    
+    void record(uint64_t ns) {
+        counts[bucketOf(ns)].fetch_add(1, memory_order_relaxed);
+        sum.fetch_add(ns, memory_order_relaxed);
+        uint64_t seen = largest.load(memory_order_relaxed);
+        while (ns > seen && !largest.compare_exchange_weak(seen, ns, memory_order_relaxed)) {
+        }
+    }
+    
+    // Summed from the buckets, so recording touches one counter less
+    uint64_t count() const {
+        uint64_t n = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            n += countAt(b);
+        }
+        return n;
+    }
+    
+    uint64_t countAt(int b) const {
+        return counts[b].load(memory_order_relaxed);
+    }
+    
+    double mean() const {
+        uint64_t n = count();
+        return n == 0 ? 0 : (double)sum.load(memory_order_relaxed) / n;
+    }
+    
+    uint64_t max() const {
+        return largest.load(memory_order_relaxed);
+    }
+    
+    // Smallest bucket top that at least fraction q of the values are at or below (0 if empty)
+    uint64_t percentile(double q) const {
+        uint64_t n = count();
+        if (n == 0) {
+            return 0;
+        }
+        uint64_t wanted = (uint64_t)ceil(q * n);
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += countAt(b);
+            if (seen >= wanted && seen > 0) {
+                return std::min(bucketTop(b), max());
+            }
+        }
+        return max();
+    }
+};
+
+// Operations timed when built with -DMIXUE_STATS
+enum StatOp { STAT_SEARCH, STAT_INSERT, STAT_REMOVE, STAT_REHASH, STAT_LOAD, STAT_SAVE, STAT_JOURNAL_SYNC, STAT_OPS };
+const char* const STAT_OP_NAMES[STAT_OPS] = {"search", "insert", "remove", "rehash", "load", "save", "journal_sync"};
+
+LatencyHistogram opLatency[STAT_OPS];
+atomic<uint64_t> probeLookups;     // Slot lookups by name (search, insert and remove each do one)
+atomic<uint64_t> probeSteps;       // Slots those lookups looked at
+
+// Records how long the enclosing scope took under one StatOp
+class ScopedLatency {
+private:
+    StatOp op;
+    chrono::steady_clock::time_point start;
+    
+public:
+    explicit ScopedLatency(StatOp op) : op(op), start(chrono::steady_clock::now()) {
+    }
+    
+    ~ScopedLatency() {
+        opLatency[op].record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+};
+
+// Without MIXUE_STATS these expand to nothing, so the hot paths carry no timing code at all
+#ifdef MIXUE_STATS
+#define STAT_TIMER(op) ScopedLatency statTimer(op)
+#define STAT_ADD(counter, n) (counter).fetch_add((n), memory_order_relaxed)
+#define STAT_ONLY(code) code
+#else
+#define STAT_TIMER(op)
+#define STAT_ADD(counter, n)
+#define STAT_ONLY(code)
+#endif
 
 string toLower(const string& s) {
     string result = s;
@@ -34,257 +253,5058 @@ string toLower(const string& s) {
     return result;
 }
 
-void printCentered(const string& text, int width = 80) {
-    int pad = (width - (int)text.length()) / 2;  // Calculate left padding
-    if (pad < 0) pad = 0;
-    cout << string(pad, ' ') << text << endl;
+// What the name indexes compare a typed query with: lowercase, spaces dropped
+// (names never contain spaces, so "mango moj" should match "MangoMojito")
+string searchKey(string_view s) {
+    string result;
+    result.reserve(s.length());
+    for (size_t i = 0; i < s.length(); i++) {
+        if (!isspace((unsigned char)s[i])) {
+            result += (char)tolower((unsigned char)s[i]);
+        }
+    }
+    return result;
+}
+
+// Multiply two 64-bit numbers and fold the 128-bit result back to 64 bits (the wyhash mixing step)
+inline uint64_t mix64(uint64_t a, uint64_t b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32, bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t lo = aLo * bLo, mid1 = aHi * bLo, mid2 = aLo * bHi, hi = aHi * bHi;
+    uint64_t cross = (lo >> 32) + (uint32_t)mid1 + (uint32_t)mid2;
+    hi += (mid1 >> 32) + (mid2 >> 32) + (cross >> 32);
+    lo = (cross << 32) | (uint32_t)lo;
+    return lo ^ hi;
+#endif
+}
+
+// Lowercase every ASCII letter in 8 packed bytes at once (same result as tolower on each byte)
+inline uint64_t foldCase8(uint64_t x) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t low7 = x & (0x7F * ones);
+    uint64_t atLeastA = low7 + (0x80 - 'A') * ones;       // top bit set where byte >= 'A'
+    uint64_t pastZ = low7 + (0x80 - 'Z' - 1) * ones;      // top bit set where byte > 'Z'
+    uint64_t upper = atLeastA & ~pastZ & ~x & (0x80 * ones);
+    return x | (upper >> 2);                              // 0x80 >> 2 == 0x20, the case bit
+}
+
+// 64-bit case-insensitive hash of a drink name. Reads 8 bytes at a time and folds case
+// inline, so it never builds a lowercase copy. Unlike summing ASCII codes, the position
+// of every byte matters, so "JasmineLemonTea" and "LemonJasmineTea" hash differently.
+uint64_t nameHash(const char* p, size_t len) {
+    const uint64_t S0 = 0xa0761d6478bd642fULL, S1 = 0xe7037ed1a0b428dbULL;
+    const uint64_t S2 = 0x8ebc6af09c88c6e3ULL, S3 = 0x589965cc75374cc3ULL;
+    uint64_t h = S0 ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t block;
+        memcpy(&block, p + i, 8);
+        h = mix64(foldCase8(block) ^ S1, h ^ S2);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, len - i);
+    h = mix64(foldCase8(tail) ^ S3, h ^ S1);
+    return mix64(h ^ S2, len ^ S0);
+}
+
+inline uint64_t nameHash(string_view s) {
+    return nameHash(s.data(), s.size());
+}
+
+// True if the query matches an already lowercased key, ignoring case in the query.
+// Compares 8 bytes at a time and makes no copies.
+bool keyMatches(const char* key, size_t len, string_view query) {
+    if (query.size() != len) {
+        return false;
+    }
+    const char* a = key;
+    const char* b = query.data();
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if (x != foldCase8(y)) {
+            return false;
+        }
+    }
+    uint64_t x = 0, y = 0;
+    memcpy(&x, a + i, len - i);
+    memcpy(&y, b + i, len - i);
+    return x == foldCase8(y);
+}
+
+struct TypeEntry;
+
+// Drinks are plain data stored in the table's arena, so the table can free
+// all of them at once instead of deleting them one by one.
+// The type is kept as two small IDs into the table's dictionaries instead of a string or
+// pointers, which keeps a node at 64 bytes, one cache line.
+struct Drink{
+	const char* name;    // In the table's arena (or a snapshot file), followed by '\0' and the lowercase key
+    uint64_t hash;       // nameHash(name), cached so probes and rehashes never recompute it
+	double price;     
+    int stock;        
+    uint32_t nameLength;
+    uint32_t typeId;        // TypeEntry::id of the type group this drink is listed under
+    uint32_t spellingId;    // TypeSpelling::id, the exact spelling of the type this drink was given
+    uint32_t row;           // This drink's row in the table's DrinkColumns
+    union {
+        Drink* prevOfType;  // Neighbours in the type group's list of drinks
+        Drink* nextFree;    // Only used while the drink sits on the table's freelist after a remove
+    };
+    Drink* nextOfType;
+    
+    // Lowercase copy of the name, made once so lookups never have to lowercase it again
+    const char* key() const {
+        return name + nameLength + 1;
+    }
+}; 
+
+static_assert(sizeof(Drink) == 64, "Drink should fill exactly one cache line");
+
+// One drink type, matched case-insensitively ("Tea" and "tea" share an entry).
+// Keeps a list of its drinks and running totals so per-type queries never scan the table.
+struct TypeEntry {
+    const char* name;       // Spelling of the first drink added with this type
+    const char* key;        // Lowercase type, used for matching
+    size_t nameLength;
+    uint64_t hash;
+    size_t count;           // Number of drinks of this type
+    long long totalStock;   // Sum of their stock
+    Drink* first;           // Drinks of this type, linked through Drink::nextOfType
+    Drink* last;
+    uint32_t id;            // Position in the table's list of types, stored in DrinkColumns::typeId
+};
+
+// One exact spelling of a type, stored once and shared by every drink that uses it
+struct TypeSpelling {
+    const char* text;
+    TypeEntry* entry;
+    uint32_t id;            // Position in the table's list of spellings, stored in Drink::spellingId
+};
+
+// Heap memory held by a HashTable, in bytes
+struct MemoryFootprint {
+    size_t arena;      // Drink nodes, names with their keys, type strings and groups
+    size_t slots;
+    size_t columns;
+    size_t types;      // The spelling and type group lists
+    
+    size_t total() const {
+        return arena + slots + columns + types;
+    }
+};
+
+// A copy of one drink, owning its strings. Safe to keep after the drink is changed or
+// removed, unlike a Drink* into the table.
+struct DrinkInfo {
+    string name;
+    string type;
+    double price;
+    int stock;
+};
+
+// One line of a sales order
+struct OrderLine {
+    string name;
+    int quantity;
+};
+
+// What became of an order: filled completely, or refused without changing anything
+struct OrderResult {
+    bool filled;
+    size_t failedLine;      // When refused, the first line that could not be filled
+    bool unknownDrink;      // ... because no drink has that name (otherwise: not enough stock)
+};
+
+// Column-wise copy of the drinks' numeric fields: row r of every array belongs to the same
+// drink. Scans that only need price or stock read just those arrays instead of pulling whole
+// Drink nodes (and the probe through the slots) through the cache. Rows are in no particular
+// order; removing a drink moves the last row into its place.
+struct DrinkColumns {
+    vector<double> price;
+    vector<int> stock;
+    vector<uint32_t> typeId;   // TypeEntry::id
+    vector<Drink*> drink;      // Back to the node, for the name
+    
+    size_t size() const {
+        return price.size();
+    }
+};
+
+// Scan kernels over DrinkColumns arrays. Each is a single pass over one or two arrays.
+// These are the portable versions; SSE2 and AVX2 versions follow, and scanKernels()
+// picks the best set the CPU can run.
+
+// Total stock value: sum of price * stock over n rows
+double stockValueKernel(const double* price, const int* stock, size_t n) {
+    double total = 0;
+    for (size_t i = 0; i < n; i++) {
+        total += price[i] * stock[i];
+    }
+    return total;
+}
+
+// Writes the rows with stock below threshold to out (room for n rows), returns how many
+size_t lowStockKernel(const int* stock, size_t n, int threshold, uint32_t* out) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+        out[found] = (uint32_t)i;
+        found += stock[i] < threshold;   // Always store, only advance on a match: no branch to mispredict
+    }
+    return found;
+}
+
+// Writes the rows with low <= price <= high to out (room for n rows), returns how many
+size_t priceRangeKernel(const double* price, size_t n, double low, double high, uint32_t* out) {
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++) {
+        out[found] = (uint32_t)i;
+        found += (price[i] >= low) & (price[i] <= high);
+    }
+    return found;
+}
+
+// Adds the number of rows with each type id to counts[id], for ids below types.
+// Four separate sets of counters, so rows of the same type do not wait on each other's increment.
+void countPerTypeKernel(const uint32_t* typeId, size_t n, size_t* counts, size_t types) {
+    vector<size_t> partial(4 * types, 0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        partial[typeId[i]]++;
+        partial[types + typeId[i + 1]]++;
+        partial[2 * types + typeId[i + 2]]++;
+        partial[3 * types + typeId[i + 3]]++;
+    }
+    for (; i < n; i++) {
+        partial[typeId[i]]++;
+    }
+    for (size_t t = 0; t < types; t++) {
+        counts[t] += partial[t] + partial[types + t] + partial[2 * types + t] + partial[3 * types + t];
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+// For each 4-bit comparison mask, the lanes that matched, packed to the front
+alignas(16) const uint32_t MATCHED_LANES[16][4] = {
+    {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0}, {2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+    {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0}, {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3},
+};
+
+// Appends rows base + lane for the matching lanes of a 4-lane mask without branching: all four
+// slots are written, and found only moves past the matches. Needs 4 free entries at out + found,
+// which the callers have because found never passes the row being scanned.
+__attribute__((target("sse2")))
+inline size_t appendMatches4(unsigned mask, size_t base, uint32_t* out, size_t found) {
+    __m128i lanes = _mm_load_si128((const __m128i*)MATCHED_LANES[mask]);
+    _mm_storeu_si128((__m128i*)(out + found), _mm_add_epi32(lanes, _mm_set1_epi32((int)base)));
+    return found + __builtin_popcount(mask);
+}
+
+__attribute__((target("sse2")))
+double stockValueSSE2(const double* price, const int* stock, size_t n) {
+    __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d s0 = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(stock + i)));
+        __m128d s1 = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(stock + i + 2)));
+        sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(price + i), s0));
+        sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(price + i + 2), s1));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, _mm_add_pd(sum0, sum1));
+    return lanes[0] + lanes[1] + stockValueKernel(price + i, stock + i, n - i);
+}
+
+__attribute__((target("sse2")))
+size_t lowStockSSE2(const int* stock, size_t n, int threshold, uint32_t* out) {
+    __m128i limit = _mm_set1_epi32(threshold);
+    size_t found = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i below = _mm_cmplt_epi32(_mm_loadu_si128((const __m128i*)(stock + i)), limit);
+        found = appendMatches4(_mm_movemask_ps(_mm_castsi128_ps(below)), i, out, found);
+    }
+    for (; i < n; i++) {
+        out[found] = (uint32_t)i;
+        found += stock[i] < threshold;
+    }
+    return found;
+}
+
+__attribute__((target("sse2")))
+size_t priceRangeSSE2(const double* price, size_t n, double low, double high, uint32_t* out) {
+    __m128d lowest = _mm_set1_pd(low), highest = _mm_set1_pd(high);
+    size_t found = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128d p0 = _mm_loadu_pd(price + i);
+        __m128d p1 = _mm_loadu_pd(price + i + 2);
+        __m128d inside0 = _mm_and_pd(_mm_cmpge_pd(p0, lowest), _mm_cmple_pd(p0, highest));
+        __m128d inside1 = _mm_and_pd(_mm_cmpge_pd(p1, lowest), _mm_cmple_pd(p1, highest));
+        found = appendMatches4(_mm_movemask_pd(inside0) | _mm_movemask_pd(inside1) << 2, i, out, found);
+    }
+    for (; i < n; i++) {
+        out[found] = (uint32_t)i;
+        found += (price[i] >= low) & (price[i] <= high);
+    }
+    return found;
+}
+
+__attribute__((target("avx2")))
+double stockValueAVX2(const double* price, const int* stock, size_t n) {
+    __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256d s0 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(stock + i)));
+        __m256d s1 = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(stock + i + 4)));
+        sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(price + i), s0));
+        sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(price + i + 4), s1));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(sum0, sum1));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + stockValueKernel(price + i, stock + i, n - i);
+}
+
+__attribute__((target("avx2")))
+size_t lowStockAVX2(const int* stock, size_t n, int threshold, uint32_t* out) {
+    __m256i limit = _mm256_set1_epi32(threshold);
+    size_t found = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i below = _mm256_cmpgt_epi32(limit, _mm256_loadu_si256((const __m256i*)(stock + i)));
+        unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(below));
+        found = appendMatches4(mask & 15, i, out, found);
+        found = appendMatches4(mask >> 4, i + 4, out, found);
+    }
+    for (; i < n; i++) {
+        out[found] = (uint32_t)i;
+        found += stock[i] < threshold;
+    }
+    return found;
+}
+
+__attribute__((target("avx2")))
+size_t priceRangeAVX2(const double* price, size_t n, double low, double high, uint32_t* out) {
+    __m256d lowest = _mm256_set1_pd(low), highest = _mm256_set1_pd(high);
+    size_t found = 0, i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d p = _mm256_loadu_pd(price + i);
+        __m256d inside = _mm256_and_pd(_mm256_cmp_pd(p, lowest, _CMP_GE_OQ), _mm256_cmp_pd(p, highest, _CMP_LE_OQ));
+        found = appendMatches4(_mm256_movemask_pd(inside), i, out, found);
+    }
+    for (; i < n; i++) {
+        out[found] = (uint32_t)i;
+        found += (price[i] >= low) & (price[i] <= high);
+    }
+    return found;
+}
+
+// With a handful of types, compare 8 ids at a time against each type and keep one vector
+// of counters per type (a matching lane adds -1, so the counters are subtracted at the end).
+// Many types would need too many comparisons, so they go to the scalar kernel.
+__attribute__((target("avx2")))
+void countPerTypeAVX2(const uint32_t* typeId, size_t n, size_t* counts, size_t types) {
+    const size_t MAX_VECTOR_TYPES = 16;
+    const size_t FLUSH_ROWS = (size_t)1 << 30;   // Flush before a 32-bit lane could overflow
+    if (types > MAX_VECTOR_TYPES) {
+        countPerTypeKernel(typeId, n, counts, types);
+        return;
+    }
+    size_t i = 0;
+    while (i + 8 <= n) {
+        __m256i hits[MAX_VECTOR_TYPES];
+        for (size_t t = 0; t < types; t++) {
+            hits[t] = _mm256_setzero_si256();
+        }
+        size_t end = i + min(n - i, FLUSH_ROWS) / 8 * 8;
+        for (; i < end; i += 8) {
+            __m256i ids = _mm256_loadu_si256((const __m256i*)(typeId + i));
+            for (size_t t = 0; t < types; t++) {
+                hits[t] = _mm256_add_epi32(hits[t], _mm256_cmpeq_epi32(ids, _mm256_set1_epi32((int)t)));
+            }
+        }
+        for (size_t t = 0; t < types; t++) {
+            int lanes[8];
+            _mm256_storeu_si256((__m256i*)lanes, hits[t]);
+            for (int k = 0; k < 8; k++) {
+                counts[t] += (size_t)(-(long long)lanes[k]);
+            }
+        }
+    }
+    for (; i < n; i++) {
+        counts[typeId[i]]++;
+    }
+}
+#endif
+
+// One complete set of scan kernels for one instruction set
+struct ScanKernels {
+    const char* name;
+    double (*stockValue)(const double* price, const int* stock, size_t n);
+    size_t (*lowStock)(const int* stock, size_t n, int threshold, uint32_t* out);
+    size_t (*priceRange)(const double* price, size_t n, double low, double high, uint32_t* out);
+    void (*countPerType)(const uint32_t* typeId, size_t n, size_t* counts, size_t types);
+};
+
+// Every kernel set this CPU can run, fastest first. The portable set is always last.
+vector<ScanKernels> availableScanKernels() {
+    vector<ScanKernels> sets;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        ScanKernels avx2 = {"AVX2", stockValueAVX2, lowStockAVX2, priceRangeAVX2, countPerTypeAVX2};
+        sets.push_back(avx2);
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        ScanKernels sse2 = {"SSE2", stockValueSSE2, lowStockSSE2, priceRangeSSE2, countPerTypeKernel};
+        sets.push_back(sse2);
+    }
+#endif
+    ScanKernels scalar = {"scalar", stockValueKernel, lowStockKernel, priceRangeKernel, countPerTypeKernel};
+    sets.push_back(scalar);
+    return sets;
+}
+
+// The kernel set used by the table, chosen once on first use
+const ScanKernels& scanKernels() {
+    static const vector<ScanKernels> sets = availableScanKernels();
+    return sets[0];
+}
+
+// Hands out memory from a few large blocks instead of one heap allocation per drink
+// or string. Blocks double in size (up to MAX_ARENA_BLOCK) and are all freed together.
+class Arena {
+private:
+    vector<char*> blocks;
+    char* current;        // Next free byte in the newest block
+    size_t remaining;     // Free bytes left in the newest block
+    size_t nextBlockSize;
+    size_t reserved;      // Total size of all blocks
+    
+public:
+    Arena() {
+        current = NULL;
+        remaining = 0;
+        nextBlockSize = FIRST_ARENA_BLOCK;
+        reserved = 0;
+    }
+    
+    ~Arena() {
+        for (size_t i = 0; i < blocks.size(); i++) {
+            delete[] blocks[i];
+        }
+    }
+    
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    
+    void* allocate(size_t bytes) {
+        bytes = (bytes + 7) & ~(size_t)7;   // Keep every allocation 8-byte aligned
+        if (bytes > remaining) {
+            size_t blockSize = max(nextBlockSize, bytes);
+            current = new char[blockSize];
+            blocks.push_back(current);
+            remaining = blockSize;
+            reserved += blockSize;
+            if (nextBlockSize < MAX_ARENA_BLOCK) {
+                nextBlockSize *= 2;
+            }
+        }
+        void* p = current;
+        current += bytes;
+        remaining -= bytes;
+        return p;
+    }
+    
+    size_t blockCount() const {
+        return blocks.size();
+    }
+    
+    size_t bytesReserved() const {
+        return reserved;
+    }
+    
+    // Takes over every block of another arena (used to merge per-thread arenas after a parallel load)
+    void adopt(Arena& other) {
+        blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+        reserved += other.reserved;
+        other.blocks.clear();
+        other.current = NULL;
+        other.remaining = 0;
+        other.reserved = 0;
+    }
+};
+
+// Bytes copyWithKey takes for a string of this length, in 8-byte words
+size_t keyedWords(size_t len) {
+    return (2 * (len + 1) + 7) / 8;
+}
+
+// Writes a string followed by its lowercase form, both NUL terminated
+void writeWithKey(char* text, string_view s) {
+    size_t len = s.length();
+    memcpy(text, s.data(), len);
+    text[len] = '\0';
+    for (size_t i = 0; i <= len; i++) {
+        text[len + 1 + i] = tolower(text[i]);
+    }
+}
+
+// Copies a string into the arena followed by its lowercase form, both NUL terminated
+char* copyWithKey(Arena& arena, string_view s) {
+    char* text = (char*)arena.allocate(keyedWords(s.length()) * 8);
+    writeWithKey(text, s);
+    return text;
+}
+
+// One slot of the table. The hash is stored next to the pointer so most probes
+// can be rejected without touching the drink itself.
+struct Slot {
+    uint64_t hash;
+    Drink* drink;   // NULL when the slot is empty
+};
+
+// Read-only view of a whole file. Uses mmap where available so even a huge
+// inventory export is never copied, otherwise falls back to reading it into memory.
+class MappedFile {
+private:
+    const char* bytes;
+    size_t length;
+    bool mapped;         // true if bytes came from mmap, false if we own a heap copy
+    vector<char> copy;
+    
+public:
+    MappedFile() {
+        bytes = NULL;
+        length = 0;
+        mapped = false;
+    }
+    
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapped && length > 0) {
+            munmap((void*)bytes, length);
+        }
+#endif
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool open(const string& filename) {
+#ifndef _WIN32
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+                bytes = (const char*)p;
+                length = (size_t)st.st_size;
+                mapped = true;
+                ::close(fd);
+                return true;
+            }
+        }
+        ::close(fd);
+#endif
+        ifstream fin(filename.c_str(), ios::binary);
+        if (!fin) {
+            return false;
+        }
+        copy.assign(istreambuf_iterator<char>(fin), istreambuf_iterator<char>());
+        bytes = copy.data();
+        length = copy.size();
+        return true;
+    }
+    
+    const char* data() const {
+        return bytes;
+    }
+    
+    size_t size() const {
+        return length;
+    }
+};
+
+// Replaces a file so that readers and crashes only ever see the old or the new contents:
+// write everything to <path>.tmp in one go, fsync it, then rename it over the old file
+// (rename is atomic) and fsync the directory so the rename itself is durable.
+bool writeFileAtomically(const string& path, const string& contents) {
+    STAT_TIMER(STAT_SAVE);
+    string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < contents.size()) {
+        long n = ::write(fd, contents.data() + done, contents.size() - done);
+        if (n <= 0) {
+            ::close(fd);
+            std::remove(tmp.c_str());
+            return false;
+        }
+        done += n;
+    }
+    bool ok = fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if (!ok) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());   // rename does not replace an existing file on Windows, so this step is not atomic there
+    return rename(tmp.c_str(), path.c_str()) == 0;
+#else
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    size_t slash = path.find_last_of('/');
+    string dir = slash == string::npos ? "." : path.substr(0, slash + 1);
+    int dirFd = ::open(dir.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        ::close(dirFd);
+    }
+    return true;
+#endif
+}
+
+// One "name type price stock" line, with name and type pointing into the file buffer
+struct DrinkRecord {
+    string_view name;
+    string_view type;
+    double price;
+    int stock;
+};
+
+inline bool isFieldSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Names and types are single fields in mixue.txt and the journal, so they cannot be empty
+// or hold spaces or line breaks
+bool isCatalogField(string_view s) {
+    if (s.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i < s.size(); i++) {
+        if (isFieldSpace(s[i]) || s[i] == '\n') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Splits one line into its four fields without copying anything.
+// Returns false if the line does not have exactly four fields or the numbers do not parse.
+bool parseDrinkLine(const char* p, const char* end, DrinkRecord& out) {
+    string_view fields[4];
+    int n = 0;
+    while (true) {
+        while (p < end && isFieldSpace(*p)) p++;
+        if (p == end) break;
+        if (n == 4) return false;     // Too many fields
+        const char* start = p;
+        while (p < end && !isFieldSpace(*p)) p++;
+        fields[n++] = string_view(start, p - start);
+    }
+    if (n != 4) {
+        return false;
+    }
+    const char* priceEnd = fields[2].data() + fields[2].size();
+    const char* stockEnd = fields[3].data() + fields[3].size();
+    if (from_chars(fields[2].data(), priceEnd, out.price).ptr != priceEnd) return false;
+    if (from_chars(fields[3].data(), stockEnd, out.stock).ptr != stockEnd) return false;
+    out.name = fields[0];
+    out.type = fields[1];
+    return true;
+}
+
+// Appends "name type price stock" without a line end.
+// to_chars writes the shortest text that reads back as exactly the same price.
+void appendDrinkFields(string& out, string_view name, string_view type, double price, int stock) {
+    char number[32];
+    out.append(name.data(), name.size());
+    out += ' ';
+    out.append(type.data(), type.size());
+    out += ' ';
+    out.append(number, to_chars(number, number + sizeof(number), price).ptr);
+    out += ' ';
+    out.append(number, to_chars(number, number + sizeof(number), stock).ptr);
+}
+
+// Appends one "name type price stock" line, the format of mixue.txt and of journal records
+void appendDrinkLine(string& out, string_view name, string_view type, double price, int stock) {
+    appendDrinkFields(out, name, type, price, stock);
+    out += '\n';
+}
+
+// Splits an order record "count name type price stock name type price stock ..." (the text
+// after "O ") into its drinks. Returns false unless it holds exactly count well formed drinks.
+bool parseOrderRecord(const char* p, const char* end, vector<DrinkRecord>& out) {
+    vector<string_view> fields;
+    while (true) {
+        while (p < end && isFieldSpace(*p)) p++;
+        if (p == end) break;
+        const char* start = p;
+        while (p < end && !isFieldSpace(*p)) p++;
+        fields.push_back(string_view(start, p - start));
+    }
+    size_t count = 0;
+    if (fields.empty() || from_chars(fields[0].data(), fields[0].data() + fields[0].size(), count).ptr !=
+                          fields[0].data() + fields[0].size() || fields.size() != 1 + 4 * count) {
+        return false;
+    }
+    out.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const string_view* f = &fields[1 + 4 * i];
+        if (from_chars(f[2].data(), f[2].data() + f[2].size(), out[i].price).ptr != f[2].data() + f[2].size() ||
+            from_chars(f[3].data(), f[3].data() + f[3].size(), out[i].stock).ptr != f[3].data() + f[3].size()) {
+            return false;
+        }
+        out[i].name = f[0];
+        out[i].type = f[1];
+    }
+    return true;
+}
+
+inline bool isBlankLine(const char* p, const char* end) {
+    while (p < end && isFieldSpace(*p)) p++;
+    return p == end;
+}
+
+// A parsed record plus its name hash, as produced by the parallel loader's parse threads
+struct ParsedDrink {
+    DrinkRecord record;
+    uint64_t hash;
+};
+
+// Guess how many lines a file has from the average line length of its first 64KB
+size_t estimateLineCount(const char* data, size_t size) {
+    size_t sample = min(size, (size_t)65536);
+    size_t lines = count(data, data + sample, '\n');
+    if (lines == 0) {
+        return 1;
+    }
+    return (size_t)((double)size * lines / sample) + 1;
+}
+
+// What a bulk load did, printed as a one line summary
+struct LoadStats {
+    size_t records;      // Lines that parsed
+    size_t duplicates;   // Records that overwrote an earlier drink with the same name
+    size_t malformed;    // Non-empty lines that did not parse
+    double elapsedMs;
+};
+
+// Shape of the slot array, worked out on demand by HashTable::health (nothing is kept up to date
+// on the hot paths). A drink's probe length is the number of slots a search for it looks at; a
+// cluster is a run of occupied slots, which a search for a missing name has to walk to its end.
+struct TableHealth {
+    static constexpr size_t TOP = 64;   // Lengths from TOP up share the last entry of the distributions
+    size_t drinks;
+    size_t slots;
+    vector<size_t> probeLengths;    // probeLengths[n] = drinks found after looking at n slots
+    vector<size_t> clusterLengths;  // clusterLengths[n] = runs of n occupied slots
+    size_t longestProbe;
+    size_t longestCluster;
+    double meanProbe;
+    double meanCluster;
+};
+
+// Binary snapshot file, an alternative to mixue.txt that loads without any parsing:
+//   SnapshotHeader
+//   SnapshotRecord[count]       one fixed-width record per drink, in slot order
+//   SnapshotType[typeCount]     one entry per distinct type spelling
+//   string table                "name\0key\0" for every drink, then "type\0" for every type
+// Integers are in the byte order of the machine that wrote the file. The checksum covers
+// everything after the header.
+struct SnapshotHeader {
+    char magic[8];          // SNAPSHOT_MAGIC
+    uint32_t version;       // SNAPSHOT_VERSION
+    uint32_t recordSize;    // sizeof(SnapshotRecord), so a layout change is caught even without a version bump
+    uint64_t count;         // Number of records
+    uint64_t typeCount;
+    uint64_t stringBytes;   // Size of the string table
+    uint64_t checksum;
+    uint64_t unused[2];
+};
+
+struct SnapshotRecord {
+    uint64_t hash;          // nameHash of the name, stored so loading never rehashes a name
+    uint64_t nameOffset;    // Into the string table, the lowercase key follows the name's NUL
+    uint32_t nameLength;
+    uint32_t type;          // Index into the type table
+    double price;
+    int32_t stock;
+    uint32_t unused;
+};
+
+struct SnapshotType {
+    uint64_t offset;        // Into the string table
+    uint64_t length;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64 && sizeof(SnapshotRecord) == 40 && sizeof(SnapshotType) == 16,
+              "snapshot structs must have the same layout on every compiler");
+
+// Checksum of the snapshot body. Four independent lanes of the wyhash mixing step keep
+// it fast enough to run on every load.
+uint64_t snapshotChecksum(const char* p, size_t len) {
+    const uint64_t S1 = 0xe7037ed1a0b428dbULL, S2 = 0x8ebc6af09c88c6e3ULL;
+    uint64_t lanes[4] = {0xa0761d6478bd642fULL, 0x589965cc75374cc3ULL, S1, S2};
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        for (int k = 0; k < 4; k++) {
+            uint64_t word;
+            memcpy(&word, p + i + 8 * k, 8);
+            lanes[k] = mix64(word ^ S1, lanes[k] ^ S2);
+        }
+    }
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        lanes[0] = mix64(word ^ S1, lanes[0] ^ S2);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, p + i, len - i);
+    uint64_t h = mix64(tail ^ S1, lanes[0] ^ len);
+    for (int k = 1; k < 4; k++) {
+        h = mix64(h ^ lanes[k], S2);
+    }
+    return h;
+}
+
+// Checks a snapshot before anything points into it: header, sizes, checksum and that
+// every offset stays inside the string table. Returns NULL if it is good, otherwise the reason.
+const char* validateSnapshot(const char* data, size_t size) {
+    if (size < sizeof(SnapshotHeader)) {
+        return "file too short";
+    }
+    const SnapshotHeader* h = (const SnapshotHeader*)data;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0) {
+        return "not a snapshot file";
+    }
+    if (h->version != SNAPSHOT_VERSION || h->recordSize != sizeof(SnapshotRecord)) {
+        return "unsupported snapshot version";
+    }
+    size_t body = size - sizeof(SnapshotHeader);
+    if (h->count > body / sizeof(SnapshotRecord) || h->typeCount > body / sizeof(SnapshotType) ||
+        h->stringBytes > body ||
+        h->count * sizeof(SnapshotRecord) + h->typeCount * sizeof(SnapshotType) + h->stringBytes != body) {
+        return "sizes do not match the file";
+    }
+    if (snapshotChecksum(data + sizeof(SnapshotHeader), body) != h->checksum) {
+        return "checksum mismatch";
+    }
+    const SnapshotRecord* records = (const SnapshotRecord*)(data + sizeof(SnapshotHeader));
+    const SnapshotType* types = (const SnapshotType*)(records + h->count);
+    const char* strings = (const char*)(types + h->typeCount);
+    for (size_t t = 0; t < h->typeCount; t++) {
+        if (types[t].length >= h->stringBytes || types[t].offset > h->stringBytes - types[t].length - 1 ||
+            strings[types[t].offset + types[t].length] != '\0') {
+            return "type outside the string table";
+        }
+    }
+    for (size_t k = 0; k < h->count; k++) {
+        const SnapshotRecord& r = records[k];
+        uint64_t bytes = 2 * ((uint64_t)r.nameLength + 1);
+        if (r.type >= h->typeCount || bytes > h->stringBytes || r.nameOffset > h->stringBytes - bytes) {
+            return "record outside the string table";
+        }
+        // Names are printed as C strings, so both the name and its key must end where the record says
+        const char* name = strings + r.nameOffset;
+        if (name[r.nameLength] != '\0' || name[bytes - 1] != '\0') {
+            return "name is not terminated";
+        }
+    }
+    return NULL;
+}
+
+void printCentered(const string& text, int width = 80) {
+    int pad = (width - (int)text.length()) / 2;  // Calculate left padding
+    if (pad < 0) pad = 0;
+    cout << string(pad, ' ') << text << endl;
+}
+
+// Search-as-you-type indexes over the drink names, built the first time a prefix or fuzzy
+// search runs and kept up to date by the table after that:
+//  - every name in key order, cut into blocks of at most NAME_BLOCK names, so a prefix is
+//    two binary searches and an insert or remove only shifts one small block;
+//  - a trigram index: each 3-byte window of "  key " lists the names that contain it.
+// Names are referred to by an id into names[]. A remove takes the id out of its block but
+// leaves it in the trigram lists, marked dead; everything is rebuilt once half the ids are dead.
+class NameIndex {
+private:
+    struct Name {
+        const char* key;
+        uint32_t length;
+        Drink* drink;       // NULL once the drink has been removed
+    };
+    vector<Name> names;
+    vector<vector<uint32_t> > blocks;                 // Live ids in key order
+    vector<vector<uint32_t> > postings;               // Per trigram seen, the ids whose key has it
+    vector<uint64_t> gramSlots;                       // Linear probing: (trigram + 1) << 32 | posting list, 0 if empty
+    int gramBits;
+    size_t live;
+    vector<uint8_t> hits;       // Per id, trigram lists it was found in during the current fuzzy search
+    bool built;
+    
+    string_view keyOf(uint32_t id) const {
+        return string_view(names[id].key, names[id].length);
+    }
+    
+    // The distinct trigrams of "  key ", sorted. Each is its three bytes packed into an int.
+    static void trigramsOf(string_view key, vector<uint32_t>& out) {
+        out.clear();
+        uint32_t window = ((uint32_t)' ' << 8) | ' ';
+        for (size_t i = 0; i <= key.length(); i++) {
+            unsigned char c = i < key.length() ? key[i] : ' ';
+            window = ((window << 8) | c) & 0xFFFFFF;
+            out.push_back(window);
+        }
+        sort(out.begin(), out.end());
+        out.erase(unique(out.begin(), out.end()), out.end());
+    }
+    
+    size_t gramSlot(uint32_t gram) const {
+        size_t mask = gramSlots.size() - 1;
+        size_t i = (size_t)(((uint64_t)gram * 0x9E3779B97F4A7C15ULL) >> (64 - gramBits));
+        while (gramSlots[i] != 0 && (gramSlots[i] >> 32) != (uint64_t)gram + 1) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+    
+    const vector<uint32_t>* findPosting(uint32_t gram) const {
+        uint64_t slot = gramSlots[gramSlot(gram)];
+        return slot == 0 ? NULL : &postings[(uint32_t)slot];
+    }
+    
+    vector<uint32_t>& postingFor(uint32_t gram) {
+        size_t i = gramSlot(gram);
+        if (gramSlots[i] == 0) {
+            if (2 * (postings.size() + 1) > gramSlots.size()) {
+                // Keep the table at most half full
+                gramBits++;
+                vector<uint64_t> old(1ULL << gramBits, 0);
+                old.swap(gramSlots);
+                for (size_t j = 0; j < old.size(); j++) {
+                    if (old[j] != 0) {
+                        gramSlots[gramSlot((uint32_t)(old[j] >> 32) - 1)] = old[j];
+                    }
+                }
+                i = gramSlot(gram);
+            }
+            gramSlots[i] = ((uint64_t)gram + 1) << 32 | postings.size();
+            postings.push_back(vector<uint32_t>());
+        }
+        return postings[(uint32_t)gramSlots[i]];
+    }
+    
+    uint32_t addName(Drink* d) {
+        Name n;
+        n.key = d->key();
+        n.length = d->nameLength;
+        n.drink = d;
+        names.push_back(n);
+        uint32_t id = names.size() - 1;
+        // Unsorted; a trigram repeated in the key finds its list already ending in id
+        uint32_t window = ((uint32_t)' ' << 8) | ' ';
+        for (size_t i = 0; i <= n.length; i++) {
+            unsigned char c = i < n.length ? n.key[i] : ' ';
+            window = ((window << 8) | c) & 0xFFFFFF;
+            vector<uint32_t>& ids = postingFor(window);
+            if (ids.empty() || ids.back() != id) {
+                ids.push_back(id);
+            }
+        }
+        live++;
+        return id;
+    }
+    
+    // The block a key belongs in: the first whose last key is not smaller, else the last block
+    size_t blockFor(string_view key) const {
+        size_t lo = 0, hi = blocks.size() - 1;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (keyOf(blocks[mid].back()) < key) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+    
+    vector<uint32_t>::iterator positionIn(vector<uint32_t>& block, string_view key) {
+        return lower_bound(block.begin(), block.end(), key,
+                           [this](uint32_t id, string_view k) { return keyOf(id) < k; });
+    }
+    
+public:
+    NameIndex() {
+        live = 0;
+        gramBits = 10;
+        gramSlots.assign(1 << gramBits, 0);
+        built = false;
+    }
+    
+    bool isBuilt() const {
+        return built;
+    }
+    
+    // Replaces the whole index with these drinks
+    void build(const vector<Drink*>& drinks) {
+        names.clear();
+        blocks.clear();
+        postings.clear();
+        gramBits = 10;
+        gramSlots.assign(1 << gramBits, 0);
+        live = 0;
+        // Sort on the first eight bytes packed big-endian, reading the keys only on a tie
+        vector<pair<uint64_t, uint32_t> > sorted;
+        sorted.reserve(drinks.size());
+        names.reserve(drinks.size());
+        for (size_t i = 0; i < drinks.size(); i++) {
+            uint32_t id = addName(drinks[i]);
+            uint64_t head = 0;
+            for (size_t c = 0; c < 8; c++) {
+                head = (head << 8) | (c < names[id].length ? (unsigned char)names[id].key[c] : 0);
+            }
+            sorted.push_back(make_pair(head, id));
+        }
+        sort(sorted.begin(), sorted.end(), [this](const pair<uint64_t, uint32_t>& a, const pair<uint64_t, uint32_t>& b) {
+            return a.first != b.first ? a.first < b.first : keyOf(a.second) < keyOf(b.second);
+        });
+        vector<uint32_t> order(sorted.size());
+        for (size_t i = 0; i < sorted.size(); i++) {
+            order[i] = sorted[i].second;
+        }
+        for (size_t i = 0; i < order.size(); i += NAME_BLOCK / 2) {
+            blocks.push_back(vector<uint32_t>(order.begin() + i, order.begin() + min(order.size(), i + NAME_BLOCK / 2)));
+        }
+        if (blocks.empty()) {
+            blocks.push_back(vector<uint32_t>());
+        }
+        built = true;
+    }
+    
+    void add(Drink* d) {
+        uint32_t id = addName(d);
+        size_t b = blockFor(keyOf(id));
+        vector<uint32_t>& block = blocks[b];
+        block.insert(positionIn(block, keyOf(id)), id);
+        if (block.size() > NAME_BLOCK) {
+            vector<uint32_t> upper(block.begin() + NAME_BLOCK / 2, block.end());
+            block.resize(NAME_BLOCK / 2);
+            blocks.insert(blocks.begin() + b + 1, upper);
+        }
+    }
+    
+    void remove(Drink* d) {
+        string_view key(d->key(), d->nameLength);
+        size_t b = blockFor(key);
+        vector<uint32_t>& block = blocks[b];
+        vector<uint32_t>::iterator pos = positionIn(block, key);
+        while (pos != block.end() && names[*pos].drink != d) {
+            ++pos;
+        }
+        if (pos == block.end()) {
+            return;
+        }
+        names[*pos].drink = NULL;
+        block.erase(pos);
+        if (block.empty() && blocks.size() > 1) {
+            blocks.erase(blocks.begin() + b);
+        }
+        live--;
+        if (names.size() >= 2 * NAME_BLOCK && live < names.size() / 2) {
+            vector<Drink*> drinks;
+            drinks.reserve(live);
+            for (size_t i = 0; i < names.size(); i++) {
+                if (names[i].drink != NULL) {
+                    drinks.push_back(names[i].drink);
+                }
+            }
+            build(drinks);
+        }
+    }
+    
+    // Up to k drinks whose key starts with prefix (already a searchKey), in key order
+    vector<Drink*> withPrefix(string_view prefix, size_t k) const {
+        vector<Drink*> found;
+        for (size_t b = blockFor(prefix); b < blocks.size() && found.size() < k; b++) {
+            const vector<uint32_t>& block = blocks[b];
+            vector<uint32_t>::const_iterator pos = lower_bound(block.begin(), block.end(), prefix,
+                                                               [this](uint32_t id, string_view p) { return keyOf(id) < p; });
+            for (; pos != block.end() && found.size() < k; ++pos) {
+                if (keyOf(*pos).substr(0, prefix.length()) != prefix) {
+                    return found;
+                }
+                found.push_back(names[*pos].drink);
+            }
+        }
+        return found;
+    }
+    
+    // Up to k drinks whose keys share the most trigrams with query (a searchKey), best first,
+    // ranked by the share of trigrams in common (common / all distinct of both), then by name.
+    // A name counts when it shares all but a few of the query's trigrams (one typo breaks at
+    // most four), and never less than half. Such a name must sit in most of the query's
+    // rarest trigram lists, so only those lists are read, counting per id how many it is in;
+    // the ids seen often enough are then scored against the query in full.
+    vector<Drink*> similar(string_view query, size_t k) {
+        vector<uint32_t> wanted;
+        trigramsOf(query, wanted);
+        size_t total = min(wanted.size(), (size_t)200);
+        wanted.resize(total);
+        size_t needed = max((total + 1) / 2, total > 4 ? total - 4 : (size_t)1);
+        vector<const vector<uint32_t>*> lists;
+        for (size_t g = 0; g < total; g++) {
+            lists.push_back(findPosting(wanted[g]));
+        }
+        sort(lists.begin(), lists.end(), [](const vector<uint32_t>* a, const vector<uint32_t>* b) {
+            return (a ? a->size() : 0) < (b ? b->size() : 0);
+        });
+        
+        // Read two lists more than the minimum, so a candidate has to be in several of them
+        size_t read = min(total, total - needed + 3);
+        size_t minHits = needed - (total - read);
+        if (hits.size() < names.size()) {
+            hits.resize(names.size(), 0);
+        }
+        vector<uint32_t> touched;
+        for (size_t l = 0; l < read; l++) {
+            if (lists[l] == NULL) {
+                continue;
+            }
+            const vector<uint32_t>& ids = *lists[l];
+            for (size_t i = 0; i < ids.size(); i++) {
+                if (hits[ids[i]]++ == 0) {
+                    touched.push_back(ids[i]);
+                }
+            }
+        }
+        
+        vector<pair<double, uint32_t> > scored;
+        vector<uint32_t> grams;
+        for (size_t t = 0; t < touched.size(); t++) {
+            uint32_t id = touched[t];
+            bool candidate = hits[id] >= minHits && names[id].drink != NULL;
+            hits[id] = 0;
+            if (!candidate) {
+                continue;
+            }
+            trigramsOf(keyOf(id), grams);
+            size_t common = 0;
+            for (size_t a = 0, b = 0; a < grams.size() && b < total; ) {
+                if (grams[a] == wanted[b]) {
+                    common++;
+                    a++;
+                    b++;
+                } else if (grams[a] < wanted[b]) {
+                    a++;
+                } else {
+                    b++;
+                }
+            }
+            if (common >= needed) {
+                scored.push_back(make_pair((double)common / (grams.size() + total - common), id));
+            }
+        }
+        
+        size_t keep = min(k, scored.size());
+        partial_sort(scored.begin(), scored.begin() + keep, scored.end(),
+                     [this](const pair<double, uint32_t>& a, const pair<double, uint32_t>& b) {
+                         return a.first != b.first ? a.first > b.first : keyOf(a.second) < keyOf(b.second);
+                     });
+        vector<Drink*> found(keep);
+        for (size_t i = 0; i < keep; i++) {
+            found[i] = names[scored[i].second].drink;
+        }
+        return found;
+    }
+};
+
+class HashTable {
+private:
+    Slot* slots;        // Flat array of slots (open addressing, linear probing)
+    size_t capacity;    // Number of slots, always a power of two
+    size_t count;       // Number of drinks currently stored
+    Arena arena;        // Memory for the drinks and their name/type strings
+    Drink* freeDrinks;  // Removed drinks, reused by the next insert
+    vector<char*> freeNames;   // Name blocks of removed drinks, one list per size in 8-byte words
+    vector<TypeSpelling> spellings;   // Interned type strings, each distinct spelling is stored once
+    vector<TypeEntry*> typeEntries;   // Secondary index: type -> drinks of that type
+    DrinkColumns columns;             // Numeric fields again, column by column, for scans
+    deque<MappedFile> snapshots;      // Snapshot files that drinks loaded from them still point into
+    NameIndex nameIndex;              // Prefix and fuzzy name search, built on first use
+    
+	// Case-insensitive hash, so "taromilktea" and "TaroMilkTea" land in the same slot
+    uint64_t hashFunction(string_view key) const {
+        return nameHash(key);
+    }
+    
+    // Returns the slot holding the drink with this name, or capacity if it is not in the table
+    // Compares the cached hash first and only then the bytes of the stored lowercase key
+    size_t findIndex(string_view name, uint64_t hash) const {
+        size_t mask = capacity - 1;
+        size_t i = hash & mask;
+        STAT_ONLY(size_t steps = 1;)
+        STAT_ADD(probeLookups, 1);
+        while (slots[i].drink != NULL) {    // An empty slot ends the probe sequence
+            if (slots[i].hash == hash && keyMatches(slots[i].drink->key(), slots[i].drink->nameLength, name)) {
+                STAT_ADD(probeSteps, steps);
+                return i;
+            }
+            i = (i + 1) & mask;
+            STAT_ONLY(steps++;)
+        }
+        STAT_ADD(probeSteps, steps);
+        return capacity;
+    }
+    
+    // Move every drink into a new slot array of the given size (no string compares needed)
+    void rehash(size_t newCapacity) {
+        STAT_TIMER(STAT_REHASH);
+        Slot* oldSlots = slots;
+        size_t oldCapacity = capacity;
+        
+        slots = new Slot[newCapacity];
+        capacity = newCapacity;
+        for (size_t i = 0; i < capacity; i++) {
+            slots[i].hash = 0;
+            slots[i].drink = NULL;
+        }
+        
+        size_t mask = capacity - 1;
+        for (size_t i = 0; i < oldCapacity; i++) {
+            if (oldSlots[i].drink != NULL) {
+                size_t j = oldSlots[i].hash & mask;
+                while (slots[j].drink != NULL) {
+                    j = (j + 1) & mask;
+                }
+                slots[j] = oldSlots[i];
+            }
+        }
+        delete[] oldSlots;
+    }
+    
+    // Case-insensitive lookup of a type group. There are only a handful of types,
+    // so a scan comparing hashes first is cheaper than another table.
+    TypeEntry* findTypeEntry(string_view type) const {
+        uint64_t hash = nameHash(type);
+        for (size_t i = 0; i < typeEntries.size(); i++) {
+            TypeEntry* e = typeEntries[i];
+            if (e->hash == hash && keyMatches(e->key, e->nameLength, type)) {
+                return e;
+            }
+        }
+        return NULL;
+    }
+    
+    // Read-only lookup of an interned spelling, NULL if the spelling was never seen
+    const TypeSpelling* findSpelling(string_view type) const {
+        for (size_t i = 0; i < spellings.size(); i++) {
+            if (type == spellings[i].text) {
+                return &spellings[i];
+            }
+        }
+        return NULL;
+    }
+    
+    // Returns the shared copy of a type string and its group, adding them the first time they are seen
+    TypeSpelling internType(string_view type) {
+        for (size_t i = 0; i < spellings.size(); i++) {
+            if (type == spellings[i].text) {
+                return spellings[i];
+            }
+        }
+        TypeSpelling spelling;
+        spelling.entry = findTypeEntry(type);
+        if (spelling.entry == NULL) {
+            TypeEntry* e = (TypeEntry*)arena.allocate(sizeof(TypeEntry));
+            e->name = copyWithKey(arena, type);
+            e->key = e->name + type.length() + 1;
+            e->nameLength = type.length();
+            e->hash = nameHash(type);
+            e->count = 0;
+            e->totalStock = 0;
+            e->first = NULL;
+            e->last = NULL;
+            e->id = (uint32_t)typeEntries.size();
+            typeEntries.push_back(e);
+            spelling.entry = e;
+        }
+        char* text = (char*)arena.allocate(type.length() + 1);
+        memcpy(text, type.data(), type.length());
+        text[type.length()] = '\0';
+        spelling.text = text;
+        spelling.id = (uint32_t)spellings.size();
+        spellings.push_back(spelling);
+        return spelling;
+    }
+    
+    // Append a drink to the end of its type's list and add it to the totals
+    void linkType(Drink* d, TypeEntry* e) {
+        d->typeId = e->id;
+        d->prevOfType = e->last;
+        d->nextOfType = NULL;
+        if (e->last != NULL) {
+            e->last->nextOfType = d;
+        } else {
+            e->first = d;
+        }
+        e->last = d;
+        e->count++;
+        e->totalStock += d->stock;
+    }
+    
+    // Give a drink that just entered the table (already linked to its type) a row in the
+    // columns, and a place in the name index if that has been built
+    void addRow(Drink* d) {
+        d->row = (uint32_t)columns.size();
+        columns.price.push_back(d->price);
+        columns.stock.push_back(d->stock);
+        columns.typeId.push_back(d->typeId);
+        columns.drink.push_back(d);
+        if (nameIndex.isBuilt()) {
+            nameIndex.add(d);
+        }
+    }
+    
+    // Fill a leaving drink's row with the last row, so the columns stay dense
+    void removeRow(Drink* d) {
+        size_t last = columns.size() - 1;
+        size_t r = d->row;
+        if (r != last) {
+            columns.price[r] = columns.price[last];
+            columns.stock[r] = columns.stock[last];
+            columns.typeId[r] = columns.typeId[last];
+            columns.drink[r] = columns.drink[last];
+            columns.drink[r]->row = (uint32_t)r;
+        }
+        columns.price.pop_back();
+        columns.stock.pop_back();
+        columns.typeId.pop_back();
+        columns.drink.pop_back();
+    }
+    
+    void unlinkType(Drink* d) {
+        TypeEntry* e = typeEntries[d->typeId];
+        if (d->prevOfType != NULL) {
+            d->prevOfType->nextOfType = d->nextOfType;
+        } else {
+            e->first = d->nextOfType;
+        }
+        if (d->nextOfType != NULL) {
+            d->nextOfType->prevOfType = d->prevOfType;
+        } else {
+            e->last = d->prevOfType;
+        }
+        e->count--;
+        e->totalStock -= d->stock;
+    }
+    
+    // Whether a name points into one of the snapshot files instead of the arena
+    bool inSnapshot(const char* name) const {
+        for (size_t i = 0; i < snapshots.size(); i++) {
+            if (name >= snapshots[i].data() && name < snapshots[i].data() + snapshots[i].size()) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Puts the name block of a removed drink on the freelist for its size. A free block
+    // keeps the next one in its first 8 bytes.
+    void releaseName(Drink* d) {
+        if (inSnapshot(d->name)) {
+            return;
+        }
+        size_t words = keyedWords(d->nameLength);
+        if (words >= freeNames.size()) {
+            freeNames.resize(words + 1, NULL);
+        }
+        char* text = (char*)d->name;
+        memcpy(text, &freeNames[words], sizeof(char*));
+        freeNames[words] = text;
+    }
+    
+    // Stores a name and its lowercase key side by side, in a block left by a removed drink
+    // of the same size if there is one, otherwise in a new arena allocation
+    char* storeName(string_view name) {
+        size_t words = keyedWords(name.length());
+        if (words < freeNames.size() && freeNames[words] != NULL) {
+            char* text = freeNames[words];
+            memcpy(&freeNames[words], text, sizeof(char*));
+            writeWithKey(text, name);
+            return text;
+        }
+        return copyWithKey(arena, name);
+    }
+    
+    // Takes a node and name block from the freelists (or the arena), so a long run of
+    // inserts and removes keeps reusing the same memory
+    Drink* newDrink(string_view name, string_view type, double price, int stock) {
+        Drink* d = freeDrinks;
+        if (d != NULL) {
+            freeDrinks = d->nextFree;
+        } else {
+            d = (Drink*)arena.allocate(sizeof(Drink));
+        }
+        TypeSpelling spelling = internType(type);
+        char* text = storeName(name);
+        d->name = text;
+        d->nameLength = (uint32_t)name.length();
+        d->hash = nameHash(name);
+        d->spellingId = spelling.id;
+        d->price = price;
+        d->stock = stock;
+        linkType(d, spelling.entry);
+        addRow(d);
+        return d;
+    }
+    
+    
+public:
+    HashTable() {   //When a HashTable is created, this sets all slots in the table to NULL (empty)
+        slots = NULL;
+        capacity = 0;
+        count = 0;
+        freeDrinks = NULL;
+        rehash(INITIAL_CAPACITY);
+    }
+
+    ~HashTable() {    //When the program ends, the arena frees every drink block by block
+        delete[] slots;
+    }
+    
+    HashTable(const HashTable&) = delete;             // The table owns its drinks, so it cannot be copied
+    HashTable& operator=(const HashTable&) = delete;
+    
+    size_t size() const {
+        return count;
+    }
+    
+    size_t slotCount() const {
+        return capacity;
+    }
+    
+    size_t arenaBlocks() const {
+        return arena.blockCount();
+    }
+    
+    // One pass over the slot array. Clusters that wrap past the last slot are counted once.
+    TableHealth health() const {
+        TableHealth h;
+        h.drinks = count;
+        h.slots = capacity;
+        h.probeLengths.assign(TableHealth::TOP + 1, 0);
+        h.clusterLengths.assign(TableHealth::TOP + 1, 0);
+        h.longestProbe = 0;
+        h.longestCluster = 0;
+        size_t probeSum = 0;
+        size_t clusters = 0;
+        size_t mask = capacity - 1;
+        for (size_t i = 0; i < capacity; i++) {
+            if (slots[i].drink != NULL) {
+                size_t probe = ((i - slots[i].hash) & mask) + 1;
+                h.probeLengths[min(probe, TableHealth::TOP)]++;
+                h.longestProbe = max(h.longestProbe, probe);
+                probeSum += probe;
+            }
+        }
+        // Start just after an empty slot, so no cluster is split in two. Load stays below 1,
+        // so there is always one.
+        size_t first = 0;
+        while (count > 0 && slots[first].drink != NULL) {
+            first++;
+        }
+        size_t run = 0;
+        for (size_t n = 1; n <= capacity; n++) {
+            if (slots[(first + n) & mask].drink != NULL) {
+                run++;
+            } else if (run > 0) {
+                h.clusterLengths[min(run, TableHealth::TOP)]++;
+                h.longestCluster = max(h.longestCluster, run);
+                clusters++;
+                run = 0;
+            }
+        }
+        h.meanProbe = count == 0 ? 0 : (double)probeSum / count;
+        h.meanCluster = clusters == 0 ? 0 : (double)count / clusters;
+        return h;
+    }
+    
+    // Bytes this table holds on the heap, counting reserved capacity, not just what is in use.
+    // Snapshot mappings are not included, they are file pages rather than heap.
+    MemoryFootprint memoryFootprint() const {
+        MemoryFootprint m;
+        m.arena = arena.bytesReserved();
+        m.slots = capacity * sizeof(Slot);
+        m.columns = columns.price.capacity() * sizeof(double) + columns.stock.capacity() * sizeof(int) +
+                    columns.typeId.capacity() * sizeof(uint32_t) + columns.drink.capacity() * sizeof(Drink*);
+        m.types = spellings.capacity() * sizeof(TypeSpelling) + typeEntries.capacity() * sizeof(TypeEntry*);
+        return m;
+    }
+    
+    // Change everything except the name of a drink that is already in the table,
+    // keeping the type index and its totals in step
+    void setDetails(Drink* d, string_view type, double price, int stock) {
+        TypeSpelling spelling = internType(type);
+        if (spelling.entry->id != d->typeId) {
+            unlinkType(d);
+            d->stock = stock;
+            linkType(d, spelling.entry);
+        } else {
+            spelling.entry->totalStock += stock - d->stock;
+            d->stock = stock;
+        }
+        d->spellingId = spelling.id;
+        d->price = price;
+        columns.price[d->row] = price;
+        columns.stock[d->row] = stock;
+        columns.typeId[d->row] = d->typeId;
+    }
+    
+    void setStock(Drink* d, int stock) {
+        typeEntries[d->typeId]->totalStock += stock - d->stock;
+        d->stock = stock;
+        columns.stock[d->row] = stock;
+    }
+    
+    // Fills an order all-or-nothing, see fillOrder. On success record holds the journal record.
+    OrderResult placeOrder(const vector<OrderLine>& lines, string& record);
+    
+    // Gives back the stock a filled order took, for an order that could not be made durable
+    void cancelOrder(const vector<OrderLine>& lines);
+    
+    // Type group for a type name (any case), or NULL if no drink ever had that type.
+    // Its count and totalStock are kept up to date, so reading them costs O(1).
+    const TypeEntry* findType(string_view type) const {
+        return findTypeEntry(type);
+    }
+    
+    // The type of a drink, spelled the way it was given
+    const char* typeName(const Drink* d) const {
+        return spellings[d->spellingId].text;
+    }
+    
+    // Calls f(const Drink*) for every drink, in slot order
+    template <class F>
+    void forEachDrink(F f) const {
+        for (size_t i = 0; i < capacity; i++) {
+            if (slots[i].drink != NULL) {
+                f(slots[i].drink);
+            }
+        }
+    }
+    
+    const DrinkColumns& columnar() const {
+        return columns;
+    }
+    
+    // Sum of price * stock over every drink
+    double totalStockValue() const {
+        return scanKernels().stockValue(columns.price.data(), columns.stock.data(), columns.size());
+    }
+    
+    // Drinks with stock below threshold, in no particular order
+    vector<Drink*> lowStock(int threshold) const {
+        vector<uint32_t> rows(columns.size());
+        rows.resize(scanKernels().lowStock(columns.stock.data(), columns.size(), threshold, rows.data()));
+        return drinksAt(rows);
+    }
+    
+    // Drinks priced from low to high inclusive, in no particular order
+    vector<Drink*> priceRange(double low, double high) const {
+        vector<uint32_t> rows(columns.size());
+        rows.resize(scanKernels().priceRange(columns.price.data(), columns.size(), low, high, rows.data()));
+        return drinksAt(rows);
+    }
+    
+    // Number of drinks of every type, indexed by TypeEntry::id
+    vector<size_t> countPerType() const {
+        vector<size_t> counts(typeEntries.size(), 0);
+        scanKernels().countPerType(columns.typeId.data(), columns.size(), counts.data(), counts.size());
+        return counts;
+    }
+    
+    vector<Drink*> drinksAt(const vector<uint32_t>& rows) const {
+        vector<Drink*> result(rows.size());
+        for (size_t i = 0; i < rows.size(); i++) {
+            result[i] = columns.drink[rows[i]];
+        }
+        return result;
+    }
+    
+    // Make room for n drinks up front, so a bulk load never has to rehash
+    void reserve(size_t n) {
+        size_t wanted = capacity;
+        while ((double)n > MAX_LOAD_FACTOR * wanted) {
+            wanted *= 2;
+        }
+        if (wanted != capacity) {
+            rehash(wanted);
+        }
+        columns.price.reserve(n);
+        columns.stock.reserve(n);
+        columns.typeId.reserve(n);
+        columns.drink.reserve(n);
+    }
+    
+    // Insert a new drink or update if it already exists in the hash table.
+    // Returns true if a new drink was added, false if an existing one was updated.
+    bool insert(string_view name, string_view type, double price, int stock) {
+        STAT_TIMER(STAT_INSERT);
+        uint64_t hash = hashFunction(name);      // Compute hash based on drink name
+        
+    	// Check if drink already exists to update
+        size_t index = findIndex(name, hash);
+        if (index != capacity) {
+            setDetails(slots[index].drink, type, price, stock);
+            return false;
+        }
+        
+        // Grow before the table gets too full, long probe sequences make every lookup slow
+        if ((double)(count + 1) > MAX_LOAD_FACTOR * capacity) {
+            rehash(capacity * 2);
+        }
+        
+        // If not found, put the new drink in the first empty slot after its home slot
+        size_t mask = capacity - 1;
+        size_t i = hash & mask;
+        while (slots[i].drink != NULL) {
+            i = (i + 1) & mask;
+        }
+        slots[i].drink = newDrink(name, type, price, stock);
+        slots[i].hash = slots[i].drink->hash;
+        count++;
+        return true;
+    }
+    
+    // Up to k drinks whose name starts with prefix (any case, spaces ignored), in name order
+    vector<Drink*> searchPrefix(string_view prefix, size_t k) {
+        buildNameIndex();
+        return nameIndex.withPrefix(searchKey(prefix), k);
+    }
+    
+    // Up to k drinks with names close to query, for typos: best match first
+    vector<Drink*> searchFuzzy(string_view query, size_t k) {
+        buildNameIndex();
+        return nameIndex.similar(searchKey(query), k);
+    }
+    
+    // What to offer when a name is not found: names starting with it, then similar names
+    vector<Drink*> suggest(string_view query, size_t k) {
+        vector<Drink*> found = searchPrefix(query, k);
+        if (found.size() < k) {
+            vector<Drink*> close = searchFuzzy(query, k);
+            for (size_t i = 0; i < close.size() && found.size() < k; i++) {
+                if (find(found.begin(), found.end(), close[i]) == found.end()) {
+                    found.push_back(close[i]);
+                }
+            }
+        }
+        return found;
+    }
+    
+    // The first prefix or fuzzy search builds the name index; from then on insert and remove keep it current
+    void buildNameIndex() {
+        if (!nameIndex.isBuilt()) {
+            vector<Drink*> drinks;
+            drinks.reserve(count);
+            forEachDrink([&](const Drink* d) { drinks.push_back((Drink*)d); });
+            nameIndex.build(drinks);
+        }
+    }
+    
+    Drink* search(string_view name) const {
+        STAT_TIMER(STAT_SEARCH);
+        size_t index = findIndex(name, hashFunction(name));
+        if (index == capacity) {
+            return NULL;
+        }
+        return slots[index].drink;
+    }
+    
+    // Copies a drink out of the table. Only reads, so several threads may call it at once
+    // as long as nothing changes the table meanwhile.
+    bool lookup(string_view name, DrinkInfo& out) const {
+        const Drink* d = search(name);
+        if (d == NULL) {
+            return false;
+        }
+        copyOut(d, out);
+        return true;
+    }
+    
+    void copyOut(const Drink* d, DrinkInfo& out) const {
+        out.name.assign(d->name, d->nameLength);
+        out.type = typeName(d);
+        out.price = d->price;
+        out.stock = d->stock;
+    }
+    	
+    bool remove(string_view name) {
+        STAT_TIMER(STAT_REMOVE);
+        size_t index = findIndex(name, hashFunction(name));
+        if (index == capacity) {
+            return false;
+        }
+        unlinkType(slots[index].drink);
+        removeRow(slots[index].drink);
+        if (nameIndex.isBuilt()) {
+            nameIndex.remove(slots[index].drink);
+        }
+        releaseName(slots[index].drink);
+        slots[index].drink->nextFree = freeDrinks;   // Keep the node for the next insert
+        freeDrinks = slots[index].drink;
+        slots[index].drink = NULL;
+        count--;
+        
+        // Backward shift: pull later drinks of the same probe run into the hole,
+        // so lookups never stop early at a gap (no tombstones needed)
+        size_t mask = capacity - 1;
+        size_t hole = index;
+        size_t j = index;
+        while (true) {
+            j = (j + 1) & mask;
+            if (slots[j].drink == NULL) {
+                break;
+            }
+            size_t home = slots[j].hash & mask;
+            // Distance from home to j, and from home to the hole (wrapping around the end)
+            if (((j - home) & mask) >= ((j - hole) & mask)) {
+                slots[hole] = slots[j];
+                slots[j].drink = NULL;
+                hole = j;
+            }
+        }
+        return true;
+    }
+    
+    void update(string_view name, string_view newType, double newPrice, int newStock) {
+        Drink* d = search(name);
+        if (d != NULL) {
+        	setDetails(d, newType, newPrice, newStock);
+            cout << "Drink details updated.\n";
+    	} else {
+        	cout << "Drink not found.\n";
+        }
+    }
+    
+    void displayAll() {
+    cout << "\n                        Drink List                         \n";
+    cout << "-------------------------------------------------------------\n";
+    cout << "| Name               | Type         | Price (RM) | Stock    |\n";
+    cout << "-------------------------------------------------------------\n";
+
+    for (size_t i = 0; i < capacity; i++) {
+        Drink* current = slots[i].drink;
+        if (current) {
+            cout << "| " << setw(18) << left << current->name
+                 << "| " << setw(13) << left << typeName(current)
+                 << "| " << setw(10) << fixed << setprecision(2) << current->price
+                 << "| " << setw(10) << current->stock
+                 << "|\n";
+        }
+    }
+	cout << "-------------------------------------------------------------\n";   
+}
+    
+    // Walks only the drinks listed under the type, not the whole table
+    void displayByType(const string& queryType) {
+    	const TypeEntry* entry = findTypeEntry(queryType);
+    	bool found = false;
+    	
+    		cout << "\n                  Drinks of type \"" << queryType << "\"   \n";
+			cout << "-------------------------------------------------------------\n";
+    		cout << "| Name               | Type         | Price (RM) | Stock    |\n";
+    		cout << "-------------------------------------------------------------\n";
+    		
+    		for (Drink* current = entry ? entry->first : NULL; current != NULL; current = current->nextOfType) {
+                cout << "| " << setw(19) << left << current->name
+                     << "| " << setw(13) << left << typeName(current)
+                     << "| " << setw(10) << fixed << setprecision(2) << current->price
+                     << "| " << setw(10) << current->stock
+                     << "|\n";
+                found = true;
+        	}
+			cout << "-------------------------------------------------------------\n";
+    	if (!found) {
+    		cout << "No drinks found for the type.\n";
+    	}
+	}
+    
+    // Report built only from column scans: total value, drinks per type, low stock and a price band
+    void displayInventoryReport(int lowStockThreshold, double lowPrice, double highPrice) {
+        vector<size_t> counts = countPerType();
+        vector<Drink*> lowStocked = lowStock(lowStockThreshold);
+        vector<Drink*> inBand = priceRange(lowPrice, highPrice);
+        
+        cout << "\n                     Inventory Report                        \n";
+        cout << "-------------------------------------------------------------\n";
+        cout << "Total inventory value: RM" << fixed << setprecision(2) << totalStockValue()
+             << "  (" << scanKernels().name << " kernels)\n";
+        for (size_t t = 0; t < typeEntries.size(); t++) {
+            if (counts[t] > 0) {
+                cout << "  " << setw(19) << left << typeEntries[t]->name << counts[t] << " drinks\n";
+            }
+        }
+        
+        const vector<Drink*>* lists[2] = {&lowStocked, &inBand};
+        for (int l = 0; l < 2; l++) {
+            if (l == 0) {
+                cout << "\n                Stock below " << lowStockThreshold << "\n";
+            } else {
+                cout << "\n                Price from RM" << lowPrice << " to RM" << highPrice << "\n";
+            }
+            cout << "-------------------------------------------------------------\n";
+            cout << "| Name               | Type         | Price (RM) | Stock    |\n";
+            cout << "-------------------------------------------------------------\n";
+            for (size_t i = 0; i < lists[l]->size(); i++) {
+                const Drink* current = (*lists[l])[i];
+                cout << "| " << setw(19) << left << current->name
+                     << "| " << setw(13) << left << typeName(current)
+                     << "| " << setw(10) << fixed << setprecision(2) << current->price
+                     << "| " << setw(10) << current->stock
+                     << "|\n";
+            }
+            cout << "-------------------------------------------------------------\n";
+            cout << lists[l]->size() << " drinks\n";
+        }
+        cout.unsetf(ios::fixed);
+    }
+    
+    // Dashboard view: drink count and total stock of every type, read straight from the index
+    void displayTypeSummary() {
+        cout << "\n                       Type Summary                          \n";
+        cout << "--------------------------------------------------------------\n";
+        cout << "| Type               | Drinks       | Total Stock            |\n";
+        cout << "--------------------------------------------------------------\n";
+        for (size_t i = 0; i < typeEntries.size(); i++) {
+            const TypeEntry* e = typeEntries[i];
+            if (e->count == 0) {
+                continue;
+            }
+            cout << "| " << setw(19) << left << e->name
+                 << "| " << setw(13) << e->count
+                 << "| " << setw(23) << e->totalStock
+                 << "|\n";
+        }
+        cout << "--------------------------------------------------------------\n";
+    }
+    
+    // Single-threaded load of a buffer, one insert per record in file order
+    void loadSequential(const char* p, const char* end, bool verbose, LoadStats& stats) {
+        size_t lineNumber = 0;
+        while (p < end) {
+            const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+            if (lineEnd == NULL) {
+                lineEnd = end;
+            }
+            lineNumber++;
+            DrinkRecord r;
+            if (parseDrinkLine(p, lineEnd, r)) {
+                if (verbose) {
+                    cout << "Loaded: " << r.name << ", " << r.type << ", " << r.price << ", " << r.stock << "\n";
+                }
+                stats.records++;
+                if (!insert(r.name, r.type, r.price, r.stock)) {    // Add each drink to the hash table
+                    stats.duplicates++;
+                }
+            } else if (!isBlankLine(p, lineEnd)) {
+                stats.malformed++;    // Blank lines are not counted as malformed
+                if (verbose) {
+                    cout << "Skipped malformed line " << lineNumber << "\n";
+                }
+            }
+            p = lineEnd + 1;
+        }
+    }
+    
+    // Multi-threaded load of a buffer in three steps:
+    //  1. Each thread parses one newline-aligned chunk and sorts its records into shards,
+    //     where shard s owns one contiguous range of slots.
+    //  2. Each shard is inserted by one thread, reading the chunks in file order so a later
+    //     record still overwrites an earlier one. Threads never touch each other's slots and
+    //     allocate from their own arena. A record whose probe would run past the end of its
+    //     range is deferred.
+    //  3. Back on one thread: merge the arenas, link new drinks into the type index, apply
+    //     updates to drinks that existed before the load, and insert the deferred records.
+    // The table must already be reserved for the load before this is called.
+    void loadParallel(const char* data, const char* end, unsigned threads, LoadStats& stats) {
+        vector<const char*> bounds(threads + 1);
+        bounds[0] = data;
+        bounds[threads] = end;
+        for (unsigned t = 1; t < threads; t++) {
+            const char* guess = max(bounds[t - 1], data + (end - data) / threads * t);
+            const char* newline = (const char*)memchr(guess, '\n', end - guess);
+            bounds[t] = newline ? newline + 1 : end;
+        }
+        
+        size_t shards = 1;
+        while (shards < 4 * threads && shards * 16 < capacity) {   // A few shards per thread evens out the work
+            shards *= 2;
+        }
+        int shardShift = 0;
+        while (((size_t)1 << shardShift) * shards < capacity) {
+            shardShift++;
+        }
+        size_t mask = capacity - 1;
+        
+        // Step 1: parse
+        vector<vector<vector<ParsedDrink>>> parsed(threads, vector<vector<ParsedDrink>>(shards));
+        vector<vector<string_view>> typesSeen(threads);
+        vector<size_t> malformed(threads, 0);
+        vector<thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.push_back(thread([&, t]() {
+                const char* p = bounds[t];
+                while (p < bounds[t + 1]) {
+                    const char* lineEnd = (const char*)memchr(p, '\n', bounds[t + 1] - p);
+                    if (lineEnd == NULL) {
+                        lineEnd = bounds[t + 1];
+                    }
+                    ParsedDrink pd;
+                    if (parseDrinkLine(p, lineEnd, pd.record)) {
+                        pd.hash = nameHash(pd.record.name);
+                        parsed[t][(pd.hash & mask) >> shardShift].push_back(pd);
+                        if (find(typesSeen[t].begin(), typesSeen[t].end(), pd.record.type) == typesSeen[t].end()) {
+                            typesSeen[t].push_back(pd.record.type);
+                        }
+                    } else if (!isBlankLine(p, lineEnd)) {
+                        malformed[t]++;
+                    }
+                    p = lineEnd + 1;
+                }
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+        workers.clear();
+        
+        // Intern every type up front so the insert threads only ever read the type tables
+        for (unsigned t = 0; t < threads; t++) {
+            stats.malformed += malformed[t];
+            for (size_t i = 0; i < typesSeen[t].size(); i++) {
+                internType(typesSeen[t][i]);
+            }
+        }
+        
+        // Step 2: sharded inserts
+        struct ShardResult {
+            Arena arena;                                   // Memory for the drinks this shard created
+            vector<Drink*> added;                          // New drinks, not yet in the type index
+            vector<pair<Drink*, const ParsedDrink*> > updates;   // Records for drinks that existed before the load
+            vector<const ParsedDrink*> deferred;           // Records whose probe left the shard's range
+            size_t records;
+            size_t duplicates;
+        };
+        vector<ShardResult> results(shards);
+        for (unsigned t = 0; t < threads; t++) {
+            workers.push_back(thread([&, t]() {
+                for (size_t s = t; s < shards; s += threads) {
+                    ShardResult& res = results[s];
+                    res.records = 0;
+                    res.duplicates = 0;
+                    size_t rangeEnd = (s + 1) << shardShift;
+                    const TypeSpelling* spelling = NULL;
+                    for (unsigned c = 0; c < threads; c++) {
+                        const vector<ParsedDrink>& batch = parsed[c][s];
+                        for (size_t k = 0; k < batch.size(); k++) {
+                            const ParsedDrink& pd = batch[k];
+                            const DrinkRecord& r = pd.record;
+                            res.records++;
+                            if (spelling == NULL || r.type != spelling->text) {
+                                spelling = findSpelling(r.type);
+                            }
+                            size_t i = pd.hash & mask;
+                            while (true) {
+                                if (i == rangeEnd) {
+                                    res.deferred.push_back(&pd);
+                                    break;
+                                }
+                                Drink* d = slots[i].drink;
+                                if (d == NULL) {
+                                    d = (Drink*)res.arena.allocate(sizeof(Drink));
+                                    char* text = copyWithKey(res.arena, r.name);
+                                    d->name = text;
+                                    d->nameLength = (uint32_t)r.name.length();
+                                    d->hash = pd.hash;
+                                    d->spellingId = spelling->id;
+                                    d->price = r.price;
+                                    d->stock = r.stock;
+                                    d->row = LOADING_ROW;    // Linked and given a row in step 3
+                                    slots[i].hash = pd.hash;
+                                    slots[i].drink = d;
+                                    res.added.push_back(d);
+                                    break;
+                                }
+                                if (slots[i].hash == pd.hash && keyMatches(d->key(), d->nameLength, r.name)) {
+                                    res.duplicates++;
+                                    if (d->row == LOADING_ROW) {     // Created by this load, safe to overwrite here
+                                        d->spellingId = spelling->id;
+                                        d->price = r.price;
+                                        d->stock = r.stock;
+                                    } else {
+                                        res.updates.push_back(make_pair(d, &pd));
+                                    }
+                                    break;
+                                }
+                                i++;
+                            }
+                        }
+                    }
+                }
+            }));
+        }
+        for (size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+        
+        // Step 3: merge
+        for (size_t s = 0; s < shards; s++) {
+            ShardResult& res = results[s];
+            arena.adopt(res.arena);
+            for (size_t k = 0; k < res.added.size(); k++) {
+                Drink* d = res.added[k];
+                linkType(d, spellings[d->spellingId].entry);
+                addRow(d);
+                count++;
+            }
+            stats.records += res.records;
+            stats.duplicates += res.duplicates;
+        }
+        reserve(count);    // In case the size estimate was too low
+        for (size_t s = 0; s < shards; s++) {
+            ShardResult& res = results[s];
+            for (size_t k = 0; k < res.updates.size(); k++) {
+                const DrinkRecord& r = res.updates[k].second->record;
+                setDetails(res.updates[k].first, r.type, r.price, r.stock);
+            }
+            for (size_t k = 0; k < res.deferred.size(); k++) {
+                const DrinkRecord& r = res.deferred[k]->record;
+                if (!insert(r.name, r.type, r.price, r.stock)) {
+                    stats.duplicates++;
+                }
+            }
+        }
+    }
+    
+    // Bulk load: maps the file, parses each line in place and prints one summary line.
+    // Later lines overwrite earlier ones with the same name. verbose echoes every record.
+    // With threads > 1, files of at least PARALLEL_LOAD_MIN_BYTES are loaded in parallel.
+    LoadStats loadFromFile(const string& filename, bool verbose = false, unsigned threads = 1) {  
+        cout << "Loading drink data from file...\n";      // Inform user that program is searching for the file
+        STAT_TIMER(STAT_LOAD);
+        LoadStats stats = {0, 0, 0, 0.0};
+        auto start = chrono::steady_clock::now();
+
+        MappedFile file;
+        if (!file.open(filename)) {
+            cout << "Unable to find file: " << filename << endl;
+            return stats;
+        }
+        const char* p = file.data();
+        const char* end = p + file.size();
+        reserve(count + estimateLineCount(p, file.size()));   // Avoid rehashing while loading
+
+        if (threads > 1 && !verbose && file.size() >= PARALLEL_LOAD_MIN_BYTES) {
+            loadParallel(p, end, threads, stats);
+        } else {
+            loadSequential(p, end, verbose, stats);
+        }
+
+        stats.elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Data loaded from " << filename << ": " << stats.records << " records, "
+             << stats.duplicates << " duplicates, " << stats.malformed << " malformed lines, "
+             << fixed << setprecision(1) << stats.elapsedMs << " ms" << endl;  // Inform user loading is done
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+        return stats;
+    }
+    
+    // The whole table in mixue.txt format, built in memory so it can be written in one go
+    string serialize() {
+        string out;
+        out.reserve(count * 32);
+        for (size_t i = 0; i < capacity; i++) {
+            Drink* current = slots[i].drink;
+            if (current != NULL) {
+                appendDrinkLine(out, string_view(current->name, current->nameLength), typeName(current),
+                                current->price, current->stock);
+            }
+        }
+        return out;
+    }
+    
+    bool saveToFile(const string& filename) {
+        if (!writeFileAtomically(filename, serialize())) {    // Check if file was written successfully
+            cout << "Cannot open file to save: " << filename << endl;
+            return false;
+        }
+        cout << "Changes saved to " << filename << endl;
+        return true;
+    }
+    
+    // The whole table as a binary snapshot (see SnapshotHeader), built in memory like serialize()
+    string serializeSnapshot() {
+        SnapshotHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+        h.version = SNAPSHOT_VERSION;
+        h.recordSize = sizeof(SnapshotRecord);
+        h.count = count;
+        h.typeCount = spellings.size();
+        for (size_t t = 0; t < spellings.size(); t++) {
+            h.stringBytes += strlen(spellings[t].text) + 1;
+        }
+        for (size_t i = 0; i < capacity; i++) {
+            if (slots[i].drink != NULL) {
+                h.stringBytes += 2 * (slots[i].drink->nameLength + 1);
+            }
+        }
+        
+        string out(sizeof(h) + count * sizeof(SnapshotRecord) + spellings.size() * sizeof(SnapshotType) + h.stringBytes, '\0');
+        SnapshotRecord* records = (SnapshotRecord*)&out[sizeof(h)];
+        SnapshotType* types = (SnapshotType*)(records + count);
+        char* strings = (char*)(types + spellings.size());
+        size_t used = 0;
+        for (size_t t = 0; t < spellings.size(); t++) {
+            types[t].offset = used;
+            types[t].length = strlen(spellings[t].text);
+            memcpy(strings + used, spellings[t].text, types[t].length);
+            used += types[t].length + 1;
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < capacity; i++) {
+            const Drink* d = slots[i].drink;
+            if (d == NULL) {
+                continue;
+            }
+            SnapshotRecord& r = records[n++];
+            r.hash = d->hash;
+            r.nameOffset = used;
+            r.nameLength = d->nameLength;
+            r.type = d->spellingId;    // The type table is written in spelling order
+            r.price = d->price;
+            r.stock = d->stock;
+            memcpy(strings + used, d->name, d->nameLength);
+            memcpy(strings + used + d->nameLength + 1, d->key(), d->nameLength);
+            used += 2 * (d->nameLength + 1);
+        }
+        h.checksum = snapshotChecksum(out.data() + sizeof(h), out.size() - sizeof(h));
+        memcpy(&out[0], &h, sizeof(h));
+        return out;
+    }
+    
+    bool saveSnapshot(const string& filename) {
+        if (!writeFileAtomically(filename, serializeSnapshot())) {
+            cout << "Cannot open file to save: " << filename << endl;
+            return false;
+        }
+        cout << "Snapshot saved to " << filename << endl;
+        return true;
+    }
+    
+    // Loads a binary snapshot. Into an empty table this is done without copying or hashing
+    // a single name: the file stays mapped, every drink's name and key point straight into
+    // it, all drinks come from one arena allocation and the records, already in slot order,
+    // drop into their slots with almost no probing. Into a table that already has drinks
+    // the records are simply inserted (later records overwrite, like loadFromFile).
+    // Returns false, leaving the table untouched, if the file is missing or fails validation.
+    bool loadFromSnapshot(const string& filename) {
+        cout << "Loading drink data from snapshot...\n";
+        STAT_TIMER(STAT_LOAD);
+        auto start = chrono::steady_clock::now();
+        
+        snapshots.emplace_back();    // A deque never moves its elements, and MappedFile cannot be moved
+        MappedFile& file = snapshots.back();
+        if (!file.open(filename)) {
+            cout << "Unable to find file: " << filename << endl;
+            snapshots.pop_back();
+            return false;
+        }
+        const char* error = validateSnapshot(file.data(), file.size());
+        if (error != NULL) {
+            cout << "Cannot load snapshot " << filename << ": " << error << endl;
+            snapshots.pop_back();
+            return false;
+        }
+        const SnapshotHeader* h = (const SnapshotHeader*)file.data();
+        const SnapshotRecord* records = (const SnapshotRecord*)(file.data() + sizeof(SnapshotHeader));
+        const SnapshotType* types = (const SnapshotType*)(records + h->count);
+        const char* strings = (const char*)(types + h->typeCount);
+        size_t recordCount = h->count;
+        
+        vector<TypeSpelling> typeSpellings(h->typeCount);
+        for (size_t t = 0; t < h->typeCount; t++) {
+            typeSpellings[t] = internType(string_view(strings + types[t].offset, types[t].length));
+        }
+        
+        size_t duplicates = 0;
+        if (count == 0) {
+            reserve(h->count);
+            Drink* nodes = (Drink*)arena.allocate(h->count * sizeof(Drink));
+            size_t mask = capacity - 1;
+            for (size_t k = 0; k < h->count; k++) {
+                const SnapshotRecord& r = records[k];
+                const char* name = strings + r.nameOffset;
+                size_t i = r.hash & mask;
+                while (slots[i].drink != NULL &&
+                       !(slots[i].hash == r.hash && keyMatches(slots[i].drink->key(), slots[i].drink->nameLength,
+                                                               string_view(name, r.nameLength)))) {
+                    i = (i + 1) & mask;
+                }
+                const TypeSpelling& spelling = typeSpellings[r.type];
+                if (slots[i].drink != NULL) {    // Only a hand-made snapshot can repeat a name
+                    setDetails(slots[i].drink, spelling.text, r.price, r.stock);
+                    duplicates++;
+                    continue;
+                }
+                Drink* d = &nodes[count];
+                d->name = name;
+                d->nameLength = r.nameLength;
+                d->hash = r.hash;
+                d->spellingId = spelling.id;
+                d->price = r.price;
+                d->stock = r.stock;
+                linkType(d, spelling.entry);
+                addRow(d);
+                slots[i].hash = r.hash;
+                slots[i].drink = d;
+                count++;
+            }
+            // The file stays in snapshots, mapped for as long as the table lives
+        } else {
+            reserve(count + h->count);
+            for (size_t k = 0; k < h->count; k++) {
+                const SnapshotRecord& r = records[k];
+                if (!insert(string_view(strings + r.nameOffset, r.nameLength), typeSpellings[r.type].text,
+                            r.price, r.stock)) {
+                    duplicates++;
+                }
+            }
+            snapshots.pop_back();    // insert copied every name into the arena
+        }
+        
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "Data loaded from " << filename << ": " << recordCount << " records, " << duplicates << " duplicates, "
+             << fixed << setprecision(1) << elapsedMs << " ms" << endl;
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+        return true;
+    }
+};
+
+// Takes every line's quantity off its drink's stock, or changes nothing and says which line
+// could not be filled (unknown drink, quantity below 1, or less stock than the order asks
+// for, counting every line of the same drink). find(name) returns the table holding a drink
+// and the drink itself (NULL if there is none). On success record gets the journal record
+// of the order: "O <drinks>" followed by the new "name type price stock" of each drink,
+// all on one line, so a torn record is skipped as a whole and replaying it twice is harmless.
+template <class Find>
+OrderResult fillOrder(const vector<OrderLine>& lines, Find find, string& record) {
+    OrderResult result;
+    result.filled = false;
+    result.unknownDrink = false;
+    vector<pair<HashTable*, Drink*> > drinks(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        drinks[i] = find(lines[i].name);
+        result.failedLine = i;
+        if (drinks[i].second == NULL) {
+            result.unknownDrink = true;
+            return result;
+        }
+        long long wanted = lines[i].quantity;
+        for (size_t j = 0; j < i; j++) {
+            if (drinks[j].second == drinks[i].second) {
+                wanted += lines[j].quantity;
+            }
+        }
+        if (lines[i].quantity < 1 || wanted > drinks[i].second->stock) {
+            return result;
+        }
+    }
+    for (size_t i = 0; i < lines.size(); i++) {
+        drinks[i].first->setStock(drinks[i].second, drinks[i].second->stock - lines[i].quantity);
+    }
+    record = "O " + to_string(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        const Drink* d = drinks[i].second;
+        record += ' ';
+        appendDrinkFields(record, string_view(d->name, d->nameLength), drinks[i].first->typeName(d), d->price, d->stock);
+    }
+    record += '\n';
+    result.filled = true;
+    return result;
+}
+
+OrderResult HashTable::placeOrder(const vector<OrderLine>& lines, string& record) {
+    return fillOrder(lines, [this](string_view name) { return make_pair(this, search(name)); }, record);
+}
+
+void HashTable::cancelOrder(const vector<OrderLine>& lines) {
+    for (size_t i = 0; i < lines.size(); i++) {
+        Drink* d = search(lines[i].name);
+        if (d != NULL) {
+            setStock(d, d->stock + lines[i].quantity);
+        }
+    }
+}
+
+// HashTable shared by several threads (one per till terminal). The drinks are split over
+// stripes by name hash, each stripe a HashTable of its own behind a reader/writer lock, so
+// lookups run side by side and writers only block the stripe they change. Nothing hands
+// out a Drink*: reads copy the drink into a DrinkInfo while the stripe is locked, and
+// changes name the drink again, so no thread can hold a node that another one removes and
+// the freelist reuses. Totals visit the stripes one at a time, each stripe is consistent
+// but the sum is not a snapshot of one instant.
+class ConcurrentHashTable {
+private:
+    struct alignas(64) Stripe {     // Own cache line, so locking one stripe does not slow its neighbours
+        shared_mutex lock;
+        HashTable table;
+    };
+    Stripe* stripes;
+    size_t stripeCount;
+    
+    // Top hash bits pick the stripe, the table inside uses the low bits for its slot
+    size_t stripeIndex(string_view name) const {
+        return (nameHash(name) >> 40) & (stripeCount - 1);
+    }
+    
+    Stripe& stripeFor(string_view name) const {
+        return stripes[stripeIndex(name)];
+    }
+    
+public:
+    explicit ConcurrentHashTable(size_t stripeCount = LOCK_STRIPES) {
+        this->stripeCount = stripeCount;
+        stripes = new Stripe[stripeCount];
+    }
+    
+    ~ConcurrentHashTable() {
+        delete[] stripes;
+    }
+    
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+    
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < stripeCount; i++) {
+            shared_lock<shared_mutex> guard(stripes[i].lock);
+            total += stripes[i].table.size();
+        }
+        return total;
+    }
+    
+    bool find(string_view name, DrinkInfo& out) const {
+        Stripe& s = stripeFor(name);
+        shared_lock<shared_mutex> guard(s.lock);
+        return s.table.lookup(name, out);
+    }
+    
+    // Same as HashTable::insert: adds the drink, or updates it if the name is taken
+    bool insert(string_view name, string_view type, double price, int stock) {
+        Stripe& s = stripeFor(name);
+        unique_lock<shared_mutex> guard(s.lock);
+        return s.table.insert(name, type, price, stock);
+    }
+    
+    // Changes a drink only if it is still there; false if another thread removed it
+    bool update(string_view name, string_view type, double price, int stock) {
+        Stripe& s = stripeFor(name);
+        unique_lock<shared_mutex> guard(s.lock);
+        Drink* d = s.table.search(name);
+        if (d == NULL) {
+            return false;
+        }
+        s.table.setDetails(d, type, price, stock);
+        return true;
+    }
+    
+    bool remove(string_view name) {
+        Stripe& s = stripeFor(name);
+        unique_lock<shared_mutex> guard(s.lock);
+        return s.table.remove(name);
+    }
+    
+    // Fills an order all-or-nothing (see fillOrder). Every stripe the order touches is locked
+    // for writing, in stripe order so two orders cannot deadlock, and stays locked while
+    // log(record) runs: records reach the journal in the order the stock changed.
+    template <class Log>
+    OrderResult placeOrder(const vector<OrderLine>& lines, Log log) {
+        vector<size_t> touched(lines.size());
+        for (size_t i = 0; i < lines.size(); i++) {
+            touched[i] = stripeIndex(lines[i].name);
+        }
+        sort(touched.begin(), touched.end());
+        touched.erase(unique(touched.begin(), touched.end()), touched.end());
+        vector<unique_lock<shared_mutex> > guards;
+        guards.reserve(touched.size());
+        for (size_t i = 0; i < touched.size(); i++) {
+            guards.push_back(unique_lock<shared_mutex>(stripes[touched[i]].lock));
+        }
+        string record;
+        OrderResult result = fillOrder(lines, [this](string_view name) {
+            HashTable& table = stripeFor(name).table;
+            return make_pair(&table, table.search(name));
+        }, record);
+        if (result.filled) {
+            log(record);
+        }
+        return result;
+    }
+    
+    // Gives back the stock a filled order took, for an order that could not be made durable
+    void cancelOrder(const vector<OrderLine>& lines) {
+        for (size_t i = 0; i < lines.size(); i++) {
+            Stripe& s = stripeFor(lines[i].name);
+            unique_lock<shared_mutex> guard(s.lock);
+            Drink* d = s.table.search(lines[i].name);
+            if (d != NULL) {
+                s.table.setStock(d, d->stock + lines[i].quantity);
+            }
+        }
+    }
+    
+    double totalStockValue() const {
+        double total = 0;
+        for (size_t i = 0; i < stripeCount; i++) {
+            shared_lock<shared_mutex> guard(stripes[i].lock);
+            total += stripes[i].table.totalStockValue();
+        }
+        return total;
+    }
+    
+    // Calls f(const DrinkInfo&) for every drink, one stripe at a time. f runs with the
+    // stripe locked for reading, so it must not call back into this table.
+    template <class F>
+    void forEachDrink(F f) const {
+        DrinkInfo info;
+        for (size_t i = 0; i < stripeCount; i++) {
+            shared_lock<shared_mutex> guard(stripes[i].lock);
+            const HashTable& table = stripes[i].table;
+            table.forEachDrink([&](const Drink* d) {
+                table.copyOut(d, info);
+                f(info);
+            });
+        }
+    }
+};
+
+// Fixed set of worker threads taking jobs from a queue. With no workers, jobs run on the
+// thread that hands them in, which makes it easy to compare against running in parallel.
+class ThreadPool {
+private:
+    vector<thread> workers;
+    deque<function<void()> > jobs;
+    mutex lock;
+    condition_variable wake;
+    bool stopping;
+    
+public:
+    explicit ThreadPool(unsigned threads) {
+        stopping = false;
+        for (unsigned i = 0; i < threads; i++) {
+            workers.push_back(thread([this]() {
+                unique_lock<mutex> guard(lock);
+                while (true) {
+                    wake.wait(guard, [this]() { return stopping || !jobs.empty(); });
+                    if (jobs.empty()) {
+                        return;     // Stopping, and every job handed in has run
+                    }
+                    function<void()> job = jobs.front();
+                    jobs.pop_front();
+                    guard.unlock();
+                    job();
+                    guard.lock();
+                }
+            }));
+        }
+    }
+    
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+    }
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    size_t threadCount() const {
+        return workers.size();
+    }
+    
+    void submit(function<void()> job) {
+        if (workers.empty()) {
+            job();
+            return;
+        }
+        {
+            lock_guard<mutex> guard(lock);
+            jobs.push_back(job);
+        }
+        wake.notify_one();
+    }
+    
+    // Runs f(i) for every i below n and returns once all of them are done. The range is cut
+    // into one piece per worker rather than one job per i, so cheap calls (a lookup per
+    // shard) do not drown in queueing. Must not be called from inside a job, the caller
+    // would hold a worker while it waits.
+    template <class F>
+    void parallelFor(size_t n, F f) {
+        size_t pieces = min(n, workers.size());
+        if (pieces <= 1) {
+            for (size_t i = 0; i < n; i++) {
+                f(i);
+            }
+            return;
+        }
+        mutex doneLock;
+        condition_variable done;
+        size_t left = pieces;
+        for (size_t p = 0; p < pieces; p++) {
+            submit([&, p]() {
+                for (size_t i = n * p / pieces; i < n * (p + 1) / pieces; i++) {
+                    f(i);
+                }
+                lock_guard<mutex> guard(doneLock);
+                if (--left == 0) {
+                    done.notify_one();
+                }
+            });
+        }
+        unique_lock<mutex> guard(doneLock);
+        done.wait(guard, [&]() { return left == 0; });
+    }
+};
+
+// One outlet's stock of some drink or type, as returned by OutletCatalog queries
+struct OutletStock {
+    string outlet;
+    long long stock;
+};
+
+struct OutletDrink {
+    string outlet;
+    DrinkInfo drink;
+};
+
+// Catalogs of many outlets, one HashTable shard per outlet behind its own reader/writer lock.
+// Changes name the outlet and go to its shard only. Queries over every outlet run one job per
+// shard on a thread pool, each job holding just its shard's read lock, and the results are
+// combined in outlet order. Like the rest of the menu, an outlet's catalog usually holds the
+// same drinks as the others with a stock of its own.
+// Outlets are added up front: addOutlet must not run at the same time as anything else.
+class OutletCatalog {
+private:
+    struct alignas(64) Outlet {
+        string name;
+        shared_mutex lock;
+        HashTable table;
+    };
+    deque<Outlet> outlets;      // A deque never moves an outlet when another is added
+    ThreadPool pool;
+    
+public:
+    explicit OutletCatalog(unsigned threads = max(1u, thread::hardware_concurrency())) : pool(threads) {
+    }
+    
+    OutletCatalog(const OutletCatalog&) = delete;
+    OutletCatalog& operator=(const OutletCatalog&) = delete;
+    
+    // Index of an outlet by name, or outletCount() if there is no such outlet. A scan, there
+    // are only dozens of outlets.
+    size_t findOutlet(string_view name) const {
+        for (size_t i = 0; i < outlets.size(); i++) {
+            if (outlets[i].name == name) {
+                return i;
+            }
+        }
+        return outlets.size();
+    }
+    
+    // Returns the outlet's index, adding it with an empty catalog if it is new
+    size_t addOutlet(string_view name) {
+        size_t i = findOutlet(name);
+        if (i == outlets.size()) {
+            outlets.emplace_back();
+            outlets.back().name = string(name);
+        }
+        return i;
+    }
+    
+    size_t outletCount() const {
+        return outlets.size();
+    }
+    
+    const string& outletName(size_t outlet) const {
+        return outlets[outlet].name;
+    }
+    
+    // Replaces nothing: the file's drinks are added to (or update) the outlet's catalog
+    LoadStats loadOutlet(size_t outlet, const string& filename) {
+        unique_lock<shared_mutex> guard(outlets[outlet].lock);
+        return outlets[outlet].table.loadFromFile(filename);
+    }
+    
+    bool insert(size_t outlet, string_view name, string_view type, double price, int stock) {
+        unique_lock<shared_mutex> guard(outlets[outlet].lock);
+        return outlets[outlet].table.insert(name, type, price, stock);
+    }
+    
+    bool remove(size_t outlet, string_view name) {
+        unique_lock<shared_mutex> guard(outlets[outlet].lock);
+        return outlets[outlet].table.remove(name);
+    }
+    
+    bool find(size_t outlet, string_view name, DrinkInfo& out) {
+        shared_lock<shared_mutex> guard(outlets[outlet].lock);
+        return outlets[outlet].table.lookup(name, out);
+    }
+    
+    // Stock of one drink added up over every outlet that has it
+    long long totalStock(string_view drink) {
+        vector<long long> stock(outlets.size(), 0);
+        pool.parallelFor(outlets.size(), [&](size_t i) {
+            shared_lock<shared_mutex> guard(outlets[i].lock);
+            const Drink* d = outlets[i].table.search(drink);
+            stock[i] = d != NULL ? d->stock : 0;
+        });
+        long long total = 0;
+        for (size_t i = 0; i < stock.size(); i++) {
+            total += stock[i];
+        }
+        return total;
+    }
+    
+    // Outlets whose drinks of this type (any case) add up to less than threshold in stock,
+    // including outlets without any drink of the type. Reads each type group's running total.
+    vector<OutletStock> outletsLowOn(string_view type, long long threshold) {
+        vector<long long> stock(outlets.size(), 0);
+        pool.parallelFor(outlets.size(), [&](size_t i) {
+            shared_lock<shared_mutex> guard(outlets[i].lock);
+            const TypeEntry* e = outlets[i].table.findType(type);
+            stock[i] = e != NULL ? e->totalStock : 0;
+        });
+        vector<OutletStock> low;
+        for (size_t i = 0; i < outlets.size(); i++) {
+            if (stock[i] < threshold) {
+                OutletStock o = {outlets[i].name, stock[i]};
+                low.push_back(o);
+            }
+        }
+        return low;
+    }
+    
+    // Every drink in every outlet with stock below threshold, grouped by outlet
+    vector<OutletDrink> lowStock(int threshold) {
+        vector<vector<DrinkInfo> > found(outlets.size());
+        pool.parallelFor(outlets.size(), [&](size_t i) {
+            shared_lock<shared_mutex> guard(outlets[i].lock);
+            const HashTable& table = outlets[i].table;
+            vector<Drink*> drinks = table.lowStock(threshold);
+            found[i].resize(drinks.size());
+            for (size_t k = 0; k < drinks.size(); k++) {
+                table.copyOut(drinks[k], found[i][k]);
+            }
+        });
+        vector<OutletDrink> all;
+        for (size_t i = 0; i < found.size(); i++) {
+            for (size_t k = 0; k < found[i].size(); k++) {
+                OutletDrink o = {outlets[i].name, found[i][k]};
+                all.push_back(o);
+            }
+        }
+        return all;
+    }
+    
+    double totalStockValue() {
+        vector<double> value(outlets.size(), 0);
+        pool.parallelFor(outlets.size(), [&](size_t i) {
+            shared_lock<shared_mutex> guard(outlets[i].lock);
+            value[i] = outlets[i].table.totalStockValue();
+        });
+        double total = 0;
+        for (size_t i = 0; i < value.size(); i++) {
+            total += value[i];
+        }
+        return total;
+    }
+};
+
+// Write-ahead journal for the catalog. Every change is appended as a record
+//   I name type price stock     (insert or update)
+//   R name                      (remove)
+//   O count name type price stock ...   (a sales order: every drink it changed, after the sale)
+// instead of rewriting mixue.txt. Records are buffered and written + fsynced in
+// batches by a background thread, or sooner when an order waits for its record to be
+// durable. On startup the journal is replayed on top of the
+// snapshot (mixue.txt). When the journal grows past JOURNAL_COMPACT_BYTES it is
+// sealed (renamed to <journal>.old), a new journal is started, and a background
+// thread writes a fresh snapshot and then deletes the sealed journal. Records say
+// what the final state of a drink is, so replaying a sealed journal over a snapshot
+// that already contains it changes nothing.
+class Journal {
+private:
+    string snapshotPath;
+    string journalPath;
+    string sealedPath;
+    int fd;                      // Journal file, opened for appending
+    size_t journalBytes;         // Bytes written to the current journal file
+    string pending;              // Records not yet written
+    size_t pendingRecords;
+    uint64_t appended;           // Records appended so far; a record's number is the count after it
+    uint64_t synced;             // Records written and fsynced so far
+    size_t syncs;                // Number of write + fsync rounds
+    bool syncing;                // A thread is writing a batch with lock released
+    bool failed;                 // A write or fsync failed: nothing more is written or confirmed
+    mutex lock;                  // Guards everything above
+    condition_variable wake;
+    condition_variable syncDone;
+    bool stopping;
+    thread flusher;              // Writes and syncs pending records every JOURNAL_SYNC_MS
+    thread compactor;            // Writes the snapshot during a compaction
+    
+    // Write and sync everything pending. Caller holds lock through guard. The write and
+    // fsync run with the lock released, so other threads keep appending meanwhile and the
+    // next round takes all of them at once (group commit); one round at a time keeps the
+    // records in the file in the order they were appended.
+    // If the write or the fsync fails, whatever part of the batch reached the file is cut off
+    // again, so replay never sees a torn line, and the journal is marked failed: the batch
+    // stays pending and nothing from then on is reported durable.
+    void flushLocked(unique_lock<mutex>& guard) {
+        while (syncing) {
+            syncDone.wait(guard);
+        }
+        if (pending.empty() || fd < 0 || failed) {
+            return;
+        }
+        string batch;
+        batch.swap(pending);
+        uint64_t last = appended;
+        size_t batchRecords = pendingRecords;
+        size_t goodBytes = journalBytes;    // End of the last batch that was written whole
+        pendingRecords = 0;
+        syncing = true;
+        guard.unlock();
+        size_t done = 0;
+        while (done < batch.size()) {
+            long n = ::write(fd, batch.data() + done, batch.size() - done);
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+        bool ok = done == batch.size();
+        if (ok) {
+            STAT_TIMER(STAT_JOURNAL_SYNC);
+            ok = fsync(fd) == 0;
+        }
+        if (!ok) {
+            cout << "Journal write failed: " << journalPath << ", changes from now on are not saved" << endl;
+            if (ftruncate(fd, goodBytes) != 0) {
+                cout << "Cannot cut the partial record off " << journalPath << endl;
+            }
+        }
+        guard.lock();
+        if (ok) {
+            journalBytes += done;
+            synced = last;
+        } else {
+            pending.insert(0, batch);
+            pendingRecords += batchRecords;
+            failed = true;
+        }
+        syncs++;
+        syncing = false;
+        syncDone.notify_all();
+    }
+    
+    // Moves the live journal's records into the sealed journal and starts an empty live one.
+    // Caller holds lock. A sealed journal that is still there (the snapshot after it was never
+    // written) is appended to rather than replaced, its records are in neither the snapshot
+    // nor the live journal. False if the records could not be moved; the live journal is
+    // then left as it was and kept open.
+    bool sealLocked() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        struct stat st;
+        bool moved;
+        if (stat(sealedPath.c_str(), &st) != 0) {
+            moved = rename(journalPath.c_str(), sealedPath.c_str()) == 0;
+        } else {
+            moved = appendToSealed();
+        }
+        fd = ::open(journalPath.c_str(), O_WRONLY | O_APPEND | O_CREAT | (moved ? O_TRUNC : 0), 0644);
+        if (!moved) {
+            cout << "Cannot seal journal: " << journalPath << endl;
+            return false;
+        }
+        journalBytes = 0;
+        return fd >= 0;
+    }
+    
+    // Copies the live journal onto the end of the sealed one and syncs it
+    bool appendToSealed() {
+        MappedFile live;
+        if (!live.open(journalPath)) {
+            return true;    // No live journal, nothing to move
+        }
+        int out = ::open(sealedPath.c_str(), O_RDWR | O_APPEND);
+        if (out < 0) {
+            return false;
+        }
+        string records;
+        char last = '\n';
+        if (lseek(out, -1, SEEK_END) >= 0 && ::read(out, &last, 1) == 1 && last != '\n') {
+            records += '\n';    // Torn last line from a crash, keep it apart from the first record
+        }
+        records.append(live.data(), live.size());
+        size_t done = 0;
+        while (done < records.size()) {
+            long n = ::write(out, records.data() + done, records.size() - done);
+            if (n <= 0) {
+                break;
+            }
+            done += n;
+        }
+        bool ok = done == records.size() && fsync(out) == 0;
+        ok = ::close(out) == 0 && ok;
+        return ok;
+    }
+    
+    // Returns the record's number, for waitDurable
+    uint64_t append(const string& record) {
+        unique_lock<mutex> guard(lock);
+        pending += record;
+        pendingRecords++;
+        uint64_t number = ++appended;
+        if (pendingRecords >= JOURNAL_BATCH) {
+            flushLocked(guard);
+        }
+        return number;
+    }
+    
+    // Applies every record of one journal file, returns how many were applied. A torn last
+    // line from a crash is skipped; complete is set to the offset just past the last '\n'.
+    size_t replayFile(const string& path, HashTable& shop, size_t& complete) {
+        complete = 0;
+        MappedFile file;
+        if (!file.open(path)) {
+            return 0;
+        }
+        size_t applied = 0;
+        vector<DrinkRecord> order;
+        const char* p = file.data();
+        const char* end = p + file.size();
+        while (p < end) {
+            const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+            if (lineEnd == NULL) {
+                break;     // Record was never completely written
+            }
+            DrinkRecord r;
+            if (lineEnd - p > 2 && p[0] == 'I' && p[1] == ' ' && parseDrinkLine(p + 2, lineEnd, r)) {
+                shop.insert(r.name, r.type, r.price, r.stock);
+                applied++;
+            } else if (lineEnd - p > 2 && p[0] == 'O' && p[1] == ' ' && parseOrderRecord(p + 2, lineEnd, order)) {
+                for (size_t i = 0; i < order.size(); i++) {
+                    shop.insert(order[i].name, order[i].type, order[i].price, order[i].stock);
+                }
+                applied++;
+            } else if (lineEnd - p > 2 && p[0] == 'R' && p[1] == ' ') {
+                const char* name = p + 2;
+                const char* nameEnd = lineEnd;
+                while (nameEnd > name && isFieldSpace(nameEnd[-1])) nameEnd--;
+                shop.remove(string_view(name, nameEnd - name));
+                applied++;
+            }
+            p = lineEnd + 1;
+            complete = p - file.data();
+        }
+        return applied;
+    }
+    
+public:
+    Journal(const string& snapshot, const string& journal) {
+        snapshotPath = snapshot;
+        journalPath = journal;
+        sealedPath = journal + ".old";
+        fd = -1;
+        journalBytes = 0;
+        pendingRecords = 0;
+        appended = 0;
+        synced = 0;
+        syncs = 0;
+        syncing = false;
+        failed = false;
+        stopping = false;
+    }
+    
+    ~Journal() {
+        {
+            unique_lock<mutex> guard(lock);
+            flushLocked(guard);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (flusher.joinable()) flusher.join();
+        if (compactor.joinable()) compactor.join();
+        if (fd >= 0) ::close(fd);
+    }
+    
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    
+    // Replay the sealed journal (left over if a compaction was interrupted) and then the
+    // live journal on top of the snapshot already loaded into the table, then open the
+    // journal for appending. A torn last line is cut off first, so the next record does not
+    // land on the end of it.
+    size_t recover(HashTable& shop) {
+        size_t complete;
+        size_t applied = replayFile(sealedPath, shop, complete);
+        applied += replayFile(journalPath, shop, complete);
+        fd = ::open(journalPath.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+        if (fd < 0) {
+            cout << "Cannot open journal: " << journalPath << endl;
+        } else {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size > complete &&
+                (ftruncate(fd, complete) != 0 || fsync(fd) != 0)) {
+                cout << "Cannot cut the torn record off " << journalPath << endl;
+                ::close(fd);
+                fd = -1;
+            }
+            journalBytes = complete;
+        }
+        flusher = thread([this]() {
+            unique_lock<mutex> guard(lock);
+            while (!stopping) {
+                wake.wait_for(guard, chrono::milliseconds(JOURNAL_SYNC_MS));
+                flushLocked(guard);
+            }
+        });
+        return applied;
+    }
+    
+    void logInsert(string_view name, string_view type, double price, int stock) {
+        string record = "I ";
+        appendDrinkLine(record, name, type, price, stock);
+        append(record);
+    }
+    
+    void logRemove(string_view name) {
+        string record = "R ";
+        record.append(name.data(), name.size());
+        record += '\n';
+        append(record);
+    }
+    
+    // record is the one line placeOrder made. Returns its number for waitDurable. Never
+    // writes itself, the caller may be holding table locks; waitDurable does the writing.
+    uint64_t logOrder(const string& record) {
+        lock_guard<mutex> guard(lock);
+        pending += record;
+        pendingRecords++;
+        return ++appended;
+    }
+    
+    // Blocks until the record with this number is on disk. Callers arriving while a batch is
+    // being synced wait for it and then sync everything appended meanwhile in one round.
+    // Returns false if the record will never be on disk: the journal could not be opened, or
+    // a write or fsync failed.
+    bool waitDurable(uint64_t number) {
+        unique_lock<mutex> guard(lock);
+        while (synced < number) {
+            if (fd < 0 || failed) {
+                return false;
+            }
+            if (syncing) {
+                syncDone.wait(guard);   // That round may already hold this record
+            } else {
+                flushLocked(guard);
+            }
+        }
+        return true;
+    }
+    
+    size_t syncCount() {
+        lock_guard<mutex> guard(lock);
+        return syncs;
+    }
+    
+    // Write and sync pending records now instead of waiting for the next batch.
+    // False once a write or fsync has failed.
+    bool flush() {
+        unique_lock<mutex> guard(lock);
+        flushLocked(guard);
+        return !failed;
+    }
+    
+    bool needsCompaction() {
+        lock_guard<mutex> guard(lock);
+        return journalBytes + pending.size() >= JOURNAL_COMPACT_BYTES;
+    }
+    
+    // Fold the journal back into the snapshot. The table is serialized here (it is not
+    // thread-safe), the file writing happens on the compactor thread unless wait is set.
+    // Returns false if the journal could not be sealed or, with wait set, the snapshot could
+    // not be written; the journals still hold every change then.
+    bool compact(HashTable& shop, bool wait = false) {
+        if (compactor.joinable()) {
+            compactor.join();    // Previous compaction must finish before the journal is sealed again
+        }
+        string snapshot = shop.serialize();
+        {
+            unique_lock<mutex> guard(lock);
+            flushLocked(guard);
+            if (!sealLocked()) {
+                return false;
+            }
+        }
+        if (wait) {
+            if (!writeFileAtomically(snapshotPath, snapshot)) {
+                return false;
+            }
+            std::remove(sealedPath.c_str());   // Snapshot now holds everything the sealed journal had
+            return true;
+        }
+        string snapshotFile = snapshotPath;
+        string sealedFile = sealedPath;
+        compactor = thread([snapshot, snapshotFile, sealedFile]() {
+            if (writeFileAtomically(snapshotFile, snapshot)) {
+                std::remove(sealedFile.c_str());
+            }
+        });
+        return true;
+    }
+};
+
+#ifdef HAVE_CATALOG_SERVICE
+// Binary protocol of the catalog service (--serve). Every message is a frame: a u32 body
+// length, then the body. Integers are little-endian, a double is its IEEE bits as a u64.
+// Request body: u8 op, then
+//   OP_SEARCH, OP_REMOVE    name (the rest of the body)
+//   OP_LIST_TYPE            type (the rest of the body)
+//   OP_INSERT, OP_UPDATE    f64 price, i32 stock, u16 name length, name, type (the rest)
+// Response body: u8 status, then for a STATUS_OK answer to
+//   OP_SEARCH               one drink
+//   OP_INSERT               u8 1 if the drink was added, 0 if an existing one was updated
+//   OP_LIST_TYPE            u32 count, then that many drinks
+// where a drink is f64 price, i32 stock, u16 name length, name, u16 type length, type.
+// Requests may be pipelined: a client can send many before reading, and the answers come
+// back in the order the requests were sent.
+enum ServiceOp { OP_SEARCH = 1, OP_INSERT = 2, OP_UPDATE = 3, OP_REMOVE = 4, OP_LIST_TYPE = 5 };
+enum ServiceStatus { STATUS_OK = 0, STATUS_NOT_FOUND = 1, STATUS_BAD_REQUEST = 2 };
+
+void putNumber(string& out, uint64_t v, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out += (char)(v >> (8 * i));
+    }
+}
+
+void putDouble(string& out, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    putNumber(out, bits, 8);
+}
+
+// Reads the fields of one frame body. Reading past the end returns zeros and clears ok.
+struct WireReader {
+    const char* p;
+    const char* end;
+    bool ok;
+    
+    WireReader(const char* begin, const char* finish) {
+        p = begin;
+        end = finish;
+        ok = true;
+    }
+    
+    uint64_t number(size_t bytes) {
+        if ((size_t)(end - p) < bytes) {
+            ok = false;
+            return 0;
+        }
+        uint64_t v = 0;
+        for (size_t i = 0; i < bytes; i++) {
+            v |= (uint64_t)(unsigned char)p[i] << (8 * i);
+        }
+        p += bytes;
+        return v;
+    }
+    
+    double real() {
+        uint64_t bits = number(8);
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    
+    string_view bytes(size_t n) {
+        if ((size_t)(end - p) < n) {
+            ok = false;
+            return string_view();
+        }
+        string_view v(p, n);
+        p += n;
+        return v;
+    }
+    
+    string_view rest() {
+        return bytes(end - p);
+    }
+};
+
+void putDrink(string& out, string_view name, string_view type, double price, int stock) {
+    putDouble(out, price);
+    putNumber(out, (uint32_t)stock, 4);
+    putNumber(out, name.size(), 2);
+    out.append(name.data(), name.size());
+    putNumber(out, type.size(), 2);
+    out.append(type.data(), type.size());
+}
+
+// A catalog field whose length also fits the 2-byte length of a response
+bool isServiceField(string_view s) {
+    return s.size() <= 0xFFFF && isCatalogField(s);
+}
+
+// A service address is "unix:PATH" or any path with a '/' for a Unix-domain socket, else
+// "[HOST:]PORT" for TCP (HOST defaults to 127.0.0.1). Returns the path, empty for TCP.
+string unixSocketPath(const string& address) {
+    if (address.compare(0, 5, "unix:") == 0) {
+        return address.substr(5);
+    }
+    return address.find('/') != string::npos ? address : string();
+}
+
+// Opens the service socket: listening when server is set, connected otherwise.
+// Returns -1 after printing why if that fails.
+int openServiceSocket(const string& address, bool server) {
+    string path = unixSocketPath(address);
+    bool local = !path.empty();
+    int fd = socket(local ? AF_UNIX : AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        cout << "Cannot create a socket for " << address << endl;
+        return -1;
+    }
+    sockaddr_un unixAddress;
+    sockaddr_in tcpAddress;
+    sockaddr* target;
+    socklen_t targetLength;
+    if (local) {
+        memset(&unixAddress, 0, sizeof(unixAddress));
+        unixAddress.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(unixAddress.sun_path)) {
+            cout << "Socket path too long: " << path << endl;
+            ::close(fd);
+            return -1;
+        }
+        memcpy(unixAddress.sun_path, path.c_str(), path.size() + 1);
+        if (server) {
+            unlink(path.c_str());     // Left behind by a service that did not shut down cleanly
+        }
+        target = (sockaddr*)&unixAddress;
+        targetLength = sizeof(unixAddress);
+    } else {
+        size_t colon = address.rfind(':');
+        string host = colon == string::npos ? "127.0.0.1" : address.substr(0, colon);
+        memset(&tcpAddress, 0, sizeof(tcpAddress));
+        tcpAddress.sin_family = AF_INET;
+        tcpAddress.sin_port = htons((uint16_t)atoi(address.c_str() + (colon == string::npos ? 0 : colon + 1)));
+        if (inet_pton(AF_INET, host.c_str(), &tcpAddress.sin_addr) != 1) {
+            cout << "Not an IPv4 address: " << host << endl;
+            ::close(fd);
+            return -1;
+        }
+        int on = 1;
+        if (server) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        } else {
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+        target = (sockaddr*)&tcpAddress;
+        targetLength = sizeof(tcpAddress);
+    }
+    bool ok = server ? bind(fd, target, targetLength) == 0 && listen(fd, 128) == 0
+                     : connect(fd, target, targetLength) == 0;
+    if (!ok) {
+        cout << "Cannot " << (server ? "listen on " : "connect to ") << address << ": " << strerror(errno) << endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+volatile sig_atomic_t serviceStopping = 0;
+int serviceWakeFd = -1;     // Write end of a pipe the service's epoll loop watches
+
+// The signal may land on any thread (the journal has two), so besides setting the flag it
+// wakes the loop through the pipe
+void stopService(int) {
+    serviceStopping = 1;
+    char byte = 1;
+    if (::write(serviceWakeFd, &byte, 1) < 0) {
+        // Pipe full: the loop is being woken already
+    }
+}
+
+// Serves the catalog over the binary protocol above, until SIGINT or SIGTERM. One thread runs
+// an epoll loop over every connection, so the table needs no locking. Each round reads what
+// every ready connection sent, answers all complete requests in it (a pipelined batch costs
+// one read and one write), then syncs the journal once for every change made in the round,
+// and only then sends the answers: a client never sees a change that could be lost.
+// A connection with SERVICE_OUTPUT_LIMIT bytes of answers unsent is not read again until
+// they drain, so a client that never reads cannot grow the server without bound.
+class CatalogService {
+private:
+    struct Connection {
+        int fd;             // -1 once closed
+        string in;          // Received bytes; those before inUsed are answered already
+        size_t inUsed;
+        string out;         // Answers; those before outSent are sent already
+        size_t outSent;
+        bool pending;       // In this round's list of connections with answers to send
+        bool reading;       // Watched for input
+        bool writing;       // Watched for room to send more
+    };
+    HashTable& shop;
+    Journal& journal;
+    int listener;
+    int epfd;
+    int wakePipe[2];                    // stopService writes to [1], the loop watches [0]
+    string socketPath;                  // Removed again on shutdown, empty for TCP
+    vector<Connection*> connections;    // By file descriptor
+    vector<Connection*> toSend;         // Connections with answers from this round
+    vector<Connection*> closed;         // Freed at the end of the round
+    bool changed;                       // The journal has records from this round
+    size_t served;
+    
+    // Read while the unsent answers are under the limit, wait for room while there are any
+    void updateWatch(Connection* c) {
+        bool read = c->out.size() - c->outSent < SERVICE_OUTPUT_LIMIT;
+        bool write = c->outSent < c->out.size();
+        if (read == c->reading && write == c->writing) {
+            return;
+        }
+        epoll_event ev;
+        ev.events = (read ? (uint32_t)EPOLLIN : 0u) | (write ? (uint32_t)EPOLLOUT : 0u);
+        ev.data.fd = c->fd;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->reading = read;
+        c->writing = write;
+    }
+    
+    void acceptAll() {
+        while (true) {
+            int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                return;     // EAGAIN: no more waiting; anything else: try again next round
+            }
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));   // Fails harmlessly on Unix sockets
+            if ((size_t)fd >= connections.size()) {
+                connections.resize(fd + 1, NULL);
+            }
+            Connection* c = new Connection();
+            c->fd = fd;
+            c->inUsed = 0;
+            c->outSent = 0;
+            c->pending = false;
+            c->reading = true;
+            c->writing = false;
+            connections[fd] = c;
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+    
+    void closeConnection(Connection* c) {
+        if (c->fd < 0) {
+            return;
+        }
+        epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        ::close(c->fd);
+        connections[c->fd] = NULL;
+        c->fd = -1;
+        closed.push_back(c);
+    }
+    
+    // Reads everything the socket has. False if the peer is gone.
+    bool readFrom(Connection* c) {
+        char buffer[64 * 1024];
+        while (true) {
+            long n = ::read(c->fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                c->in.append(buffer, n);
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return true;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+    }
+    
+    // Answers every complete request received so far, until the unsent answers reach the limit.
+    // False if the client sent something that is not a frame.
+    bool answer(Connection* c) {
+        while (c->out.size() - c->outSent < SERVICE_OUTPUT_LIMIT) {
+            size_t available = c->in.size() - c->inUsed;
+            if (available < 4) {
+                break;
+            }
+            WireReader header(c->in.data() + c->inUsed, c->in.data() + c->in.size());
+            size_t length = header.number(4);
+            if (length == 0 || length > SERVICE_MAX_FRAME) {
+                return false;
+            }
+            if (available < 4 + length) {
+                break;
+            }
+            const char* body = c->in.data() + c->inUsed + 4;
+            handle(body, body + length, c->out);
+            c->inUsed += 4 + length;
+            served++;
+        }
+        if (c->inUsed > 0 && c->inUsed * 2 >= c->in.size()) {
+            c->in.erase(0, c->inUsed);
+            c->inUsed = 0;
+        }
+        if (c->out.size() > c->outSent && !c->pending) {
+            c->pending = true;
+            toSend.push_back(c);
+        }
+        return true;
+    }
+    
+    // Appends the answer frame to one request body
+    void handle(const char* body, const char* end, string& out) {
+        size_t start = out.size();
+        out.append(4, '\0');     // Body length, filled in below
+        WireReader r(body, end);
+        int op = (int)r.number(1);
+        if (op == OP_SEARCH) {
+            const Drink* d = shop.search(r.rest());
+            if (d != NULL) {
+                out += (char)STATUS_OK;
+                putDrink(out, string_view(d->name, d->nameLength), shop.typeName(d), d->price, d->stock);
+            } else {
+                out += (char)STATUS_NOT_FOUND;
+            }
+        } else if (op == OP_INSERT || op == OP_UPDATE) {
+            double price = r.real();
+            int stock = (int)(uint32_t)r.number(4);
+            string_view name = r.bytes(r.number(2));
+            string_view type = r.rest();
+            if (!r.ok || !isServiceField(name) || !isServiceField(type)) {
+                out += (char)STATUS_BAD_REQUEST;
+            } else if (op == OP_INSERT) {
+                journal.logInsert(name, type, price, stock);
+                bool added = shop.insert(name, type, price, stock);
+                changed = true;
+                out += (char)STATUS_OK;
+                out += (char)(added ? 1 : 0);
+            } else {
+                Drink* d = shop.search(name);
+                if (d != NULL) {
+                    journal.logInsert(string_view(d->name, d->nameLength), type, price, stock);
+                    shop.setDetails(d, type, price, stock);
+                    changed = true;
+                    out += (char)STATUS_OK;
+                } else {
+                    out += (char)STATUS_NOT_FOUND;
+                }
+            }
+        } else if (op == OP_REMOVE) {
+            string_view name = r.rest();
+            if (shop.remove(name)) {
+                journal.logRemove(name);
+                changed = true;
+                out += (char)STATUS_OK;
+            } else {
+                out += (char)STATUS_NOT_FOUND;
+            }
+        } else if (op == OP_LIST_TYPE) {
+            const TypeEntry* e = shop.findType(r.rest());
+            out += (char)STATUS_OK;
+            putNumber(out, e != NULL ? e->count : 0, 4);
+            for (const Drink* d = e != NULL ? e->first : NULL; d != NULL; d = d->nextOfType) {
+                putDrink(out, string_view(d->name, d->nameLength), shop.typeName(d), d->price, d->stock);
+            }
+        } else {
+            out += (char)STATUS_BAD_REQUEST;
+        }
+        size_t length = out.size() - start - 4;
+        for (size_t i = 0; i < 4; i++) {
+            out[start + i] = (char)(length >> (8 * i));
+        }
+    }
+    
+    // Sends as much as the socket takes. False if the peer is gone.
+    bool writeTo(Connection* c) {
+        while (c->outSent < c->out.size()) {
+            long n = send(c->fd, c->out.data() + c->outSent, c->out.size() - c->outSent, MSG_NOSIGNAL);
+            if (n > 0) {
+                c->outSent += n;
+            } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+        if (c->outSent == c->out.size()) {
+            c->out.clear();
+            c->outSent = 0;
+        }
+        return true;
+    }
+    
+public:
+    CatalogService(HashTable& shop, Journal& journal) : shop(shop), journal(journal) {
+        listener = -1;
+        epfd = -1;
+        wakePipe[0] = -1;
+        wakePipe[1] = -1;
+        changed = false;
+        served = 0;
+    }
+    
+    ~CatalogService() {
+        for (size_t i = 0; i < connections.size(); i++) {
+            if (connections[i] != NULL) {
+                ::close(connections[i]->fd);
+                delete connections[i];
+            }
+        }
+        if (epfd >= 0) ::close(epfd);
+        if (listener >= 0) {
+            ::close(listener);
+            if (!socketPath.empty()) {
+                unlink(socketPath.c_str());
+            }
+        }
+        if (wakePipe[0] >= 0) {
+            serviceWakeFd = -1;
+            ::close(wakePipe[0]);
+            ::close(wakePipe[1]);
+        }
+    }
+    
+    CatalogService(const CatalogService&) = delete;
+    CatalogService& operator=(const CatalogService&) = delete;
+    
+    bool start(const string& address) {
+        listener = openServiceSocket(address, true);
+        if (listener < 0) {
+            return false;
+        }
+        socketPath = unixSocketPath(address);
+        fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+        epfd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = listener;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, listener, &ev);
+        if (pipe2(wakePipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+            return false;
+        }
+        serviceWakeFd = wakePipe[1];
+        ev.data.fd = wakePipe[0];
+        epoll_ctl(epfd, EPOLL_CTL_ADD, wakePipe[0], &ev);
+        return true;
+    }
+    
+    // Serves until SIGINT or SIGTERM, returns how many requests were answered
+    size_t run() {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = stopService;
+        sigaction(SIGINT, &action, NULL);
+        sigaction(SIGTERM, &action, NULL);
+        epoll_event events[256];
+        while (!serviceStopping) {
+            int n = epoll_wait(epfd, events, 256, -1);
+            if (n < 0) {
+                continue;   // EINTR, loop checks serviceStopping
+            }
+            for (int i = 0; i < n; i++) {
+                if (events[i].data.fd == listener) {
+                    acceptAll();
+                    continue;
+                }
+                if (events[i].data.fd == wakePipe[0]) {
+                    continue;   // Stopping, the loop ends after this round
+                }
+                Connection* c = connections[events[i].data.fd];
+                if (c == NULL) {
+                    continue;
+                }
+                bool alive = true;
+                if (events[i].events & EPOLLOUT) {
+                    alive = writeTo(c);
+                }
+                if (alive && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+                    alive = readFrom(c);
+                }
+                if (alive) {
+                    alive = answer(c);    // Also what stayed buffered while the answers were over the limit
+                }
+                if (!alive) {
+                    closeConnection(c);
+                } else if (!c->pending) {
+                    updateWatch(c);
+                }
+            }
+            
+            if (changed) {
+                if (!journal.flush()) {     // One sync covers every change answered this round
+                    cout << "Stopping: this round's changes could not be saved, so they are not answered" << endl;
+                    break;
+                }
+                changed = false;
+                if (journal.needsCompaction()) {
+                    journal.compact(shop);
+                }
+            }
+            for (size_t i = 0; i < toSend.size(); i++) {
+                Connection* c = toSend[i];
+                c->pending = false;
+                if (c->fd < 0) {
+                    continue;
+                }
+                if (!writeTo(c)) {
+                    closeConnection(c);
+                } else {
+                    updateWatch(c);
+                }
+            }
+            toSend.clear();
+            for (size_t i = 0; i < closed.size(); i++) {
+                delete closed[i];
+            }
+            closed.clear();
+        }
+        return served;
+    }
+};
+#endif
+
+void waitForEnter() {
+    cout << "\nPress Enter to continue...";
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');  //Clears any leftover input from the user 
+    cin.get();
+}
+
+void clearScreen() {
+#ifdef _WIN32
+    system("cls");
+#else
+    system("clear");
+#endif
+}
+
+// Ask user for an integer input with validation
+int getValidatedInt(const string& prompt) {
+    int value;
+    while (true) {
+        cout << prompt;
+        if (cin >> value) {
+            cin.ignore(numeric_limits<streamsize>::max(), '\n'); 
+            return value;
+        } else {
+            cout << "Invalid input. Please enter a valid integer.\n";
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        }
+    }
+}
+
+// Ask user for a number input with validation
+double getValidatedDouble(const string& prompt) {
+    double value;
+    while (true) {
+        cout << prompt;
+        if (cin >> value) {
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            return value;
+        } else {
+            cout << "Invalid input. Please enter a valid number.\n";
+            cin.clear();
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        }
+    }
+}
+
+// Ask user for a drink name or type, one word with no spaces
+string getValidatedField(const string& prompt) {
+    string value;
+    while (true) {
+        cout << prompt;
+        getline(cin, value);
+        if (isCatalogField(value)) {
+            return value;
+        }
+        cout << "Invalid input. Please enter one word with no spaces.\n";
+    }
+}
+
+// Builds tables of 50 up to 1M drinks and times random lookups in each one,
+// with an open addressing table the time per lookup should stay roughly flat.
+// Half of the hit queries are upper case to exercise the case-insensitive compare,
+// and the heap allocations made during the timed loops are counted (should be zero).
+void runLookupBenchmark() {
+    const size_t sizes[] = {50, 1000, 10000, 100000, 1000000};
+    const int LOOKUPS = 1000000;
+    mt19937 rng(12345);
+    
+    cout << "Lookup benchmark (" << LOOKUPS << " lookups per table size)\n";
+    cout << "------------------------------------------------------------------------------\n";
+    cout << "| Drinks     | Hit (ns/op)  | Miss (ns/op) | Allocs/op    | Slots        |\n";
+    cout << "------------------------------------------------------------------------------\n";
+    
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        HashTable shop;
+        vector<string> names;
+        names.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            names.push_back("Drink" + to_string(i));
+            shop.insert(names.back(), "Beverage", 10, 100);
+        }
+        
+        // Pick the queries up front so only the lookups are timed
+        vector<string> hits, misses;
+        hits.reserve(LOOKUPS);
+        misses.reserve(LOOKUPS);
+        uniform_int_distribution<size_t> pick(0, n - 1);
+        for (int i = 0; i < LOOKUPS; i++) {
+            string hit = names[pick(rng)];
+            if (i % 2 == 1) {
+                transform(hit.begin(), hit.end(), hit.begin(), ::toupper);
+            }
+            hits.push_back(hit);
+            misses.push_back("Missing" + to_string(pick(rng)));
+        }
+        
+        size_t found = 0;
+        size_t allocsBefore = heapAllocations.load();
+        auto t0 = chrono::steady_clock::now();
+        for (int i = 0; i < LOOKUPS; i++) {
+            if (shop.search(hits[i]) != NULL) found++;
+        }
+        auto t1 = chrono::steady_clock::now();
+        for (int i = 0; i < LOOKUPS; i++) {
+            if (shop.search(misses[i]) != NULL) found++;
+        }
+        auto t2 = chrono::steady_clock::now();
+        size_t allocs = heapAllocations.load() - allocsBefore;
+        
+        if (found != (size_t)LOOKUPS) {
+            cout << "Benchmark error: expected " << LOOKUPS << " hits, got " << found << endl;
+        }
+        double hitNs = chrono::duration<double, nano>(t1 - t0).count() / LOOKUPS;
+        double missNs = chrono::duration<double, nano>(t2 - t1).count() / LOOKUPS;
+        cout << "| " << setw(11) << left << n
+             << "| " << setw(13) << fixed << setprecision(1) << hitNs
+             << "| " << setw(13) << missNs
+             << "| " << setw(13) << allocationCell((double)allocs / (2.0 * LOOKUPS), 3)
+             << "| " << setw(13) << shop.slotCount()
+             << "|\n";
+    }
+    cout << "------------------------------------------------------------------------------\n";
+}
+
+// Times building and destroying tables of 10K to 1M drinks and counts the heap
+// allocations made, which should stay at a handful thanks to the arena
+void runLoadBenchmark() {
+    const size_t sizes[] = {10000, 100000, 1000000};
+    const char* typeNames[] = {"Beverage", "Juice", "Tea"};
+    
+    cout << "Load/teardown benchmark\n";
+    cout << "------------------------------------------------------------------------------\n";
+    cout << "| Drinks     | Load (ms)    | Allocations  | Arena blocks | Teardown (ms) |\n";
+    cout << "------------------------------------------------------------------------------\n";
+    
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        vector<string> names;
+        names.reserve(n);
+        for (size_t i = 0; i < n; i++) {
+            names.push_back("Drink" + to_string(i));
+        }
+        string types[3] = {typeNames[0], typeNames[1], typeNames[2]};
+        
+        size_t allocsBefore = heapAllocations.load();
+        auto t0 = chrono::steady_clock::now();
+        chrono::steady_clock::time_point t1;
+        size_t allocs, blocks;
+        {
+            HashTable shop;
+            for (size_t i = 0; i < n; i++) {
+                shop.insert(names[i], types[i % 3], 10, 100);
+            }
+            t1 = chrono::steady_clock::now();
+            allocs = heapAllocations.load() - allocsBefore;
+            blocks = shop.arenaBlocks();
+        }   // Teardown happens here
+        auto t2 = chrono::steady_clock::now();
+        
+        cout << "| " << setw(11) << left << n
+             << "| " << setw(13) << fixed << setprecision(1) << chrono::duration<double, milli>(t1 - t0).count()
+             << "| " << setw(13) << allocationCell(allocs, 0)
+             << "| " << setw(13) << blocks
+             << "| " << setw(14) << chrono::duration<double, milli>(t2 - t1).count()
+             << "|\n";
+    }
+    cout << "------------------------------------------------------------------------------\n";
+}
+
+// Writes a synthetic file in which most names repeat, then loads it with 1 to 16 threads.
+// Every parallel load is checked against the single-threaded result.
+void runParallelLoadBenchmark(size_t lines) {
+    const string filename = "bench_parallel_load.txt";
+    {
+        ofstream out(filename.c_str());
+        const char* typeNames[] = {"Beverage", "Juice", "Tea"};
+        mt19937 rng(99);
+        for (size_t i = 0; i < lines; i++) {
+            out << "Drink" << rng() % (lines / 2 + 1) << ' ' << typeNames[rng() % 3] << ' '
+                << 5 + rng() % 25 << ' ' << rng() % 500 << '\n';
+        }
+    }
+    
+    HashTable reference;
+    reference.loadFromFile(filename, false, 1);
+    
+    const unsigned threadCounts[] = {1, 2, 4, 8, 16};
+    const size_t RUNS = sizeof(threadCounts) / sizeof(threadCounts[0]);
+    double times[RUNS];
+    bool matches[RUNS];
+    for (size_t run = 0; run < RUNS; run++) {
+        HashTable shop;
+        times[run] = shop.loadFromFile(filename, false, threadCounts[run]).elapsedMs;
+        matches[run] = shop.size() == reference.size();
+        for (size_t i = 0; i < lines / 2 && matches[run]; i += 97) {
+            string name = "Drink" + to_string(i);
+            Drink* a = reference.search(name);
+            Drink* b = shop.search(name);
+            if ((a == NULL) != (b == NULL) || (a && (a->stock != b->stock || a->price != b->price))) {
+                matches[run] = false;
+            }
+        }
+    }
+    std::remove(filename.c_str());
+    
+    cout << "\nParallel load benchmark (" << lines << " lines, " << reference.size() << " distinct drinks, "
+         << thread::hardware_concurrency() << " hardware threads)\n";
+    cout << "-------------------------------------------------------------\n";
+    cout << "| Threads    | Load (ms)    | Speedup      | Same result  |\n";
+    cout << "-------------------------------------------------------------\n";
+    for (size_t run = 0; run < RUNS; run++) {
+        cout << "| " << setw(11) << left << threadCounts[run]
+             << "| " << setw(13) << fixed << setprecision(1) << times[run]
+             << "| " << setw(13) << setprecision(2) << times[0] / times[run]
+             << "| " << setw(13) << (matches[run] ? "yes" : "NO")
+             << "|\n";
+    }
+    cout << "-------------------------------------------------------------\n";
+}
+
+// Repeatedly kills a child process while it is saving a ~5MB snapshot and checks the file
+// each time. With atomic saves it must always hold one complete snapshot, the plain
+// truncate-and-write save is run the same way for comparison.
+void runSaveTortureTest(int iterations) {
+#ifdef _WIN32
+    cout << "The save torture test needs fork/kill and only runs on POSIX systems.\n";
+#else
+    const string path = "torture_snapshot.txt";
+    string versions[2];
+    for (int v = 0; v < 2; v++) {
+        for (int i = 0; i < 150000; i++) {
+            appendDrinkLine(versions[v], "Drink" + to_string(i), "Beverage", 10 + v, i + v);
+        }
+    }
+    mt19937 rng(2024);
+    
+    for (int atomic = 1; atomic >= 0; atomic--) {
+        writeFileAtomically(path, versions[0]);
+        int complete = 0, torn = 0;
+        for (int it = 0; it < iterations; it++) {
+            pid_t child = fork();
+            if (child == 0) {
+                for (int k = 1; ; k++) {
+                    if (atomic) {
+                        writeFileAtomically(path, versions[k % 2]);
+                    } else {
+                        ofstream fout(path.c_str(), ios::binary | ios::trunc);
+                        fout.write(versions[k % 2].data(), versions[k % 2].size());
+                    }
+                }
+            }
+            usleep(1000 + rng() % 30000);    // Let it get somewhere random in a save
+            kill(child, SIGKILL);
+            waitpid(child, NULL, 0);
+            
+            ifstream fin(path.c_str(), ios::binary);
+            string contents((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+            if (contents == versions[0] || contents == versions[1]) {
+                complete++;
+            } else {
+                torn++;
+            }
+        }
+        cout << (atomic ? "Atomic save      : " : "Truncate + write : ") << complete << " complete, "
+             << torn << " torn out of " << iterations << " kills\n";
+    }
+    std::remove(path.c_str());
+    std::remove((path + ".tmp").c_str());
+#endif
+}
+
+// Hash used by the original 50-bucket table, kept only so the report can compare against it
+uint64_t legacyAdditiveHash(const string& key) {
+    string lowerKey = toLower(key);
+    uint64_t hash = 0;
+    for (size_t i = 0; i < lowerKey.length(); i++) {
+        hash += (unsigned char)lowerKey[i];
+    }
+    return hash;
+}
+
+// Prints how evenly one hash function spreads the names over the given number of buckets
+void printBucketStats(const string& label, const vector<string>& names, size_t buckets, bool legacy) {
+    vector<size_t> occupancy(buckets, 0);
+    vector<uint64_t> hashes;
+    hashes.reserve(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        uint64_t h = legacy ? legacyAdditiveHash(names[i]) : nameHash(names[i]);
+        occupancy[h % buckets]++;
+        hashes.push_back(h);
+    }
+    
+    size_t used = 0, longest = 0;
+    double probes = 0;    // Average compares for a successful lookup in a chained table
+    size_t histogram[6] = {0};   // Buckets holding 0, 1, 2, 3, 4-7, 8+ names
+    for (size_t b = 0; b < buckets; b++) {
+        size_t c = occupancy[b];
+        if (c > 0) used++;
+        if (c > longest) longest = c;
+        probes += c * (c + 1) / 2.0;
+        histogram[c < 4 ? c : (c < 8 ? 4 : 5)]++;
+    }
+    sort(hashes.begin(), hashes.end());
+    size_t fullCollisions = hashes.size() - (unique(hashes.begin(), hashes.end()) - hashes.begin());
+    
+    cout << label << "\n";
+    cout << "  buckets used        : " << used << " / " << buckets
+         << " (" << fixed << setprecision(1) << 100.0 * used / buckets << "%)\n";
+    cout << "  longest bucket      : " << longest << "\n";
+    cout << "  avg compares (hit)  : " << setprecision(2) << (names.empty() ? 0 : probes / names.size()) << "\n";
+    cout << "  full-hash collisions: " << fullCollisions << "\n";
+    cout << "  bucket sizes 0/1/2/3/4-7/8+ : " << histogram[0] << " / " << histogram[1] << " / "
+         << histogram[2] << " / " << histogram[3] << " / " << histogram[4] << " / " << histogram[5] << "\n\n";
+}
+
+// Compares bucket occupancy of the old additive hash and nameHash, over the names in
+// the data file (50 buckets, like the original table) and over a synthetic 1M name corpus
+void runHashReport(const string& filename) {
+    vector<string> fileNames;
+    ifstream fin(filename.c_str());
+    string name, type;
+    double price;
+    int stock;
+    while (fin >> name >> type >> price >> stock) {
+        fileNames.push_back(name);
+    }
+    sort(fileNames.begin(), fileNames.end());
+    fileNames.erase(unique(fileNames.begin(), fileNames.end()), fileNames.end());
+    
+    cout << "=== Hash distribution report ===\n\n";
+    cout << "Anagram check: JasmineLemonTea / LemonJasmineTea\n";
+    cout << "  additive: " << legacyAdditiveHash("JasmineLemonTea") << " / " << legacyAdditiveHash("LemonJasmineTea") << "\n";
+    cout << "  nameHash: " << hex << nameHash(string("JasmineLemonTea")) << " / " << nameHash(string("LemonJasmineTea")) << dec << "\n\n";
+    
+    cout << "--- " << filename << ": " << fileNames.size() << " distinct names, 50 buckets ---\n";
+    printBucketStats("Additive ASCII hash", fileNames, 50, true);
+    printBucketStats("nameHash", fileNames, 50, false);
+    
+    // Synthetic corpus built from shuffled menu words, which is full of anagram-like names
+    const char* flavours[] = {"Brown", "Sugar", "Mango", "Taro", "Lychee", "Jasmine", "Lemon", "Peach",
+                              "Coconut", "Strawberry", "Avocado", "Choco", "Winter", "Melon", "Oolong", "Pineapple"};
+    const char* bases[] = {"MilkTea", "GreenTea", "IceTea", "Slush", "Smoothie", "Mojito", "Breeze", "Pearl"};
+    const size_t F = sizeof(flavours) / sizeof(flavours[0]);
+    const size_t B = sizeof(bases) / sizeof(bases[0]);
+    const size_t CORPUS = 1000000;
+    vector<string> synthetic;
+    synthetic.reserve(CORPUS);
+    for (size_t i = 0; i < CORPUS; i++) {
+        size_t a = i % F, b = (i / F) % F, c = (i / (F * F)) % B;
+        synthetic.push_back(string(flavours[a]) + flavours[b] + bases[c] + to_string(i / (F * F * B)));
+    }
+    size_t buckets = 1;
+    while (buckets < CORPUS / MAX_LOAD_FACTOR) buckets *= 2;   // Slot count the table would use
+    
+    cout << "--- Synthetic corpus: " << CORPUS << " names, " << buckets << " buckets ---\n";
+    printBucketStats("Additive ASCII hash", synthetic, buckets, true);
+    printBucketStats("nameHash", synthetic, buckets, false);
+}
+
+// Converts a mixue.txt style text file into a binary snapshot
+bool convertToSnapshot(const string& textFile, const string& snapshotFile) {
+    if (!ifstream(textFile.c_str())) {
+        cout << "Unable to find file: " << textFile << endl;
+        return false;
+    }
+    HashTable shop;
+    shop.loadFromFile(textFile, false, max(1u, thread::hardware_concurrency()));
+    return shop.saveSnapshot(snapshotFile);
+}
+
+// Converts a binary snapshot back into the mixue.txt text format
+bool convertToText(const string& snapshotFile, const string& textFile) {
+    HashTable shop;
+    if (!shop.loadFromSnapshot(snapshotFile)) {
+        return false;
+    }
+    return shop.saveToFile(textFile);
+}
+
+// Startup time from mixue.txt text versus a binary snapshot of the same catalog.
+// Each size is written in both formats, then loaded into a fresh table from each
+// (text on every hardware thread) and spot-checked. Sizes above maxDrinks are skipped.
+void runStartupBenchmark(size_t maxDrinks) {
+    const size_t sizes[] = {10000, 1000000, 10000000};
+    const char* typeNames[] = {"Beverage", "Juice", "Tea"};
+    const string textFile = "bench_startup.txt";
+    const string snapshotFile = "bench_startup.bin";
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    
+    struct Row {
+        size_t drinks;
+        size_t textBytes, snapshotBytes;
+        double textMs, snapshotMs;
+        bool same;
+    };
+    vector<Row> rows;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && sizes[s] <= maxDrinks; s++) {
+        size_t n = sizes[s];
+        Row row = {n, 0, 0, 0.0, 0.0, true};
+        {
+            HashTable shop;
+            shop.reserve(n);
+            char name[32];
+            for (size_t i = 0; i < n; i++) {
+                size_t len = snprintf(name, sizeof(name), "Drink%zu", i);
+                shop.insert(string_view(name, len), typeNames[i % 3], 3 + (i % 50) * 0.5, i % 500);
+            }
+            string text = shop.serialize();
+            row.textBytes = text.size();
+            writeFileAtomically(textFile, text);
+            text = string();
+            string snapshot = shop.serializeSnapshot();
+            row.snapshotBytes = snapshot.size();
+            writeFileAtomically(snapshotFile, snapshot);
+        }
+        
+        for (int format = 0; format < 2; format++) {
+            HashTable shop;
+            auto t0 = chrono::steady_clock::now();
+            if (format == 0) {
+                shop.loadFromFile(textFile, false, threads);
+            } else {
+                shop.loadFromSnapshot(snapshotFile);
+            }
+            double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            (format == 0 ? row.textMs : row.snapshotMs) = ms;
+            
+            bool same = shop.size() == n;
+            for (size_t i = 0; i < n && same; i += 997) {
+                Drink* d = shop.search("drink" + to_string(i));
+                same = d != NULL && d->stock == (int)(i % 500) && d->price == 3 + (i % 50) * 0.5 &&
+                       strcmp(shop.typeName(d), typeNames[i % 3]) == 0;
+            }
+            const TypeEntry* tea = shop.findType("tea");
+            same = same && tea != NULL && tea->count == n / 3;
+            row.same = row.same && same;
+        }
+        rows.push_back(row);
+    }
+    std::remove(textFile.c_str());
+    std::remove(snapshotFile.c_str());
+    
+    cout << "\nStartup benchmark (text loaded on " << threads << " threads)\n";
+    cout << "--------------------------------------------------------------------------------------------------\n";
+    cout << "| Drinks     | Text (MB)  | Text load (ms) | Snapshot (MB) | Snapshot load (ms) | Speedup | Same |\n";
+    cout << "--------------------------------------------------------------------------------------------------\n";
+    for (size_t r = 0; r < rows.size(); r++) {
+        cout << "| " << setw(11) << left << rows[r].drinks
+             << "| " << setw(11) << fixed << setprecision(1) << rows[r].textBytes / 1048576.0
+             << "| " << setw(15) << rows[r].textMs
+             << "| " << setw(14) << rows[r].snapshotBytes / 1048576.0
+             << "| " << setw(19) << rows[r].snapshotMs
+             << "| " << setw(8) << setprecision(2) << rows[r].textMs / rows[r].snapshotMs
+             << "| " << setw(5) << (rows[r].same ? "yes" : "NO")
+             << "|\n";
+    }
+    cout << "--------------------------------------------------------------------------------------------------\n";
+}
+
+// Compares the scan kernels over DrinkColumns with the same query done the old way, walking
+// the slots and reading each Drink node, on 10K to 1M drinks. Times are per drink scanned.
+void runColumnBenchmark() {
+    const size_t sizes[] = {10000, 100000, 1000000};
+    const char* typeNames[] = {"Beverage", "Juice", "Tea"};
+    const int LOW_STOCK = 20;
+    const double LOW_PRICE = 10, HIGH_PRICE = 15;
+    mt19937 rng(15);
+    
+    cout << "Column scan benchmark (ns per drink)\n";
+    cout << "------------------------------------------------------------------------------\n";
+    cout << "| Drinks     | Query         | Row walk     | Columns      | Speedup  | Same |\n";
+    cout << "------------------------------------------------------------------------------\n";
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        HashTable shop;
+        shop.reserve(n);
+        char name[32];
+        for (size_t i = 0; i < n; i++) {
+            size_t len = snprintf(name, sizeof(name), "Drink%zu", i);
+            shop.insert(string_view(name, len), typeNames[rng() % 3], 5 + (rng() % 40) * 0.5, rng() % 500);
+        }
+        for (size_t i = 0; i < n / 10; i++) {    // Some removes, so rows have been moved around
+            size_t len = snprintf(name, sizeof(name), "Drink%zu", (size_t)(rng() % n));
+            shop.remove(string_view(name, len));
+        }
+        size_t rounds = max((size_t)1, 20000000 / n);   // About 20M drinks scanned per measurement
+        
+        for (int query = 0; query < 3; query++) {
+            double times[2];
+            double totals[2];
+            vector<Drink*> found[2];
+            for (int columnar = 0; columnar < 2; columnar++) {
+                auto t0 = chrono::steady_clock::now();
+                for (size_t r = 0; r < rounds; r++) {
+                    if (query == 0) {
+                        double total = 0;
+                        if (columnar) {
+                            total = shop.totalStockValue();
+                        } else {
+                            shop.forEachDrink([&](const Drink* d) { total += d->price * d->stock; });
+                        }
+                        totals[columnar] = total;
+                    } else {
+                        vector<Drink*>& result = found[columnar];
+                        if (columnar) {
+                            result = query == 1 ? shop.lowStock(LOW_STOCK) : shop.priceRange(LOW_PRICE, HIGH_PRICE);
+                        } else {
+                            result.clear();
+                            shop.forEachDrink([&](const Drink* d) {
+                                if (query == 1 ? d->stock < LOW_STOCK : d->price >= LOW_PRICE && d->price <= HIGH_PRICE) {
+                                    result.push_back((Drink*)d);
+                                }
+                            });
+                        }
+                    }
+                }
+                times[columnar] = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / rounds / shop.size();
+            }
+            const char* queryNames[] = {"stock value", "low stock", "price range"};
+            bool same;
+            if (query == 0) {
+                same = fabs(totals[0] - totals[1]) <= 1e-9 * fabs(totals[0]);   // Summed in a different order
+            } else {
+                sort(found[0].begin(), found[0].end());
+                sort(found[1].begin(), found[1].end());
+                same = found[0] == found[1];
+            }
+            cout << "| " << setw(11) << left << (query == 0 ? to_string(n) : "")
+                 << "| " << setw(14) << queryNames[query]
+                 << "| " << setw(13) << fixed << setprecision(2) << times[0]
+                 << "| " << setw(13) << times[1]
+                 << "| " << setw(9) << times[0] / times[1]
+                 << "| " << setw(5) << (same ? "yes" : "NO")
+                 << "|\n";
+        }
+    }
+    cout << "------------------------------------------------------------------------------\n";
+    cout.unsetf(ios::fixed);
+}
+
+// Prefix and fuzzy search over n generated names like "MangoPearlTea17": time to build the
+// name index on first use, then microseconds per query (mean and p99, top 10 results).
+// Fuzzy queries are real names with one typo (a letter changed, dropped or swapped), and
+// recall is how often the intended drink is among the results. Finally the table takes
+// random inserts and removes and prefix results are checked against a full scan.
+void runNameSearchBenchmark(size_t n) {
+    const char* words[] = {"Mango", "Taro", "Brown", "Sugar", "Pearl", "Jasmine", "Green", "Milk", "Tea",
+                           "Lemon", "Peach", "Oolong", "Lychee", "Coconut", "Strawberry", "Grape", "Honey",
+                           "Matcha", "Cocoa", "Coffee", "Winter", "Melon", "Pineapple", "Passion", "Fruit",
+                           "Cheese", "Foam", "Boba", "Jelly", "Pudding", "Red", "Bean", "Yogurt", "Orange",
+                           "Kiwi", "Apple", "Rose", "Oat", "Caramel", "Vanilla"};
+    const size_t WORDS = sizeof(words) / sizeof(words[0]);
+    const size_t K = 10;
+    const int QUERIES = 2000;
+    mt19937 rng(19);
+    auto randomName = [&](size_t i) {
+        return string(words[rng() % WORDS]) + words[rng() % WORDS] + words[rng() % WORDS] + to_string(i % 1000);
+    };
+    
+    HashTable shop;
+    shop.reserve(n);
+    vector<string> names;
+    names.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        names.push_back(randomName(i));
+        shop.insert(names.back(), "Tea", 10, 100);
+    }
+    auto t0 = chrono::steady_clock::now();
+    shop.buildNameIndex();
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    
+    cout << "Name search benchmark: " << shop.size() << " drinks, index built in " << fixed << setprecision(1)
+         << buildMs << " ms\n";
+    cout << "--------------------------------------------------------------------------\n";
+    cout << "| Query          | Mean (us)    | p99 (us)     | Results/query | Recall  |\n";
+    cout << "--------------------------------------------------------------------------\n";
+    for (int fuzzy = 0; fuzzy < 2; fuzzy++) {
+        vector<double> times;
+        size_t results = 0;
+        int recalled = 0;
+        for (int q = 0; q < QUERIES; q++) {
+            const string& target = names[rng() % names.size()];
+            string query;
+            if (!fuzzy) {
+                query = target.substr(0, 2 + rng() % 5);
+            } else {
+                query = target;
+                size_t at = rng() % (query.size() - 1);
+                int edit = rng() % 3;
+                if (edit == 0) {
+                    query[at] = 'a' + rng() % 26;
+                } else if (edit == 1) {
+                    query.erase(at, 1);
+                } else {
+                    swap(query[at], query[at + 1]);
+                }
+            }
+            auto q0 = chrono::steady_clock::now();
+            vector<Drink*> found = fuzzy ? shop.searchFuzzy(query, K) : shop.searchPrefix(query, K);
+            times.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - q0).count());
+            results += found.size();
+            for (size_t i = 0; i < found.size(); i++) {
+                if (!fuzzy ? searchKey(found[i]->name).compare(0, query.size(), searchKey(query)) == 0 :
+                             target == found[i]->name) {
+                    recalled++;
+                    break;
+                }
+            }
+        }
+        double total = 0;
+        for (size_t i = 0; i < times.size(); i++) {
+            total += times[i];
+        }
+        sort(times.begin(), times.end());
+        cout << "| " << setw(15) << left << (fuzzy ? "fuzzy (1 typo)" : "prefix (2-6)")
+             << "| " << setw(13) << total / times.size()
+             << "| " << setw(13) << times[times.size() * 99 / 100]
+             << "| " << setw(14) << (double)results / QUERIES
+             << "| " << setw(7) << 100.0 * recalled / QUERIES << "%|\n";
+    }
+    cout << "--------------------------------------------------------------------------\n";
+    
+    // Keep changing the table, then compare prefix results with a scan of every drink
+    for (int i = 0; i < 20000; i++) {
+        if (rng() % 2) {
+            names.push_back(randomName(rng()));
+            shop.insert(names.back(), "Juice", 12, 50);
+        } else {
+            shop.remove(names[rng() % names.size()]);
+        }
+    }
+    bool same = true;
+    for (int q = 0; q < 200 && same; q++) {
+        string prefix = searchKey(names[rng() % names.size()].substr(0, 1 + rng() % 4));
+        vector<string> expected;
+        shop.forEachDrink([&](const Drink* d) {
+            string key(d->key(), d->nameLength);
+            if (key.compare(0, prefix.size(), prefix) == 0) {
+                expected.push_back(key);
+            }
+        });
+        sort(expected.begin(), expected.end());
+        expected.resize(min(expected.size(), K));
+        vector<Drink*> found = shop.searchPrefix(prefix, K);
+        same = found.size() == expected.size();
+        for (size_t i = 0; same && i < found.size(); i++) {
+            same = string(found[i]->key(), found[i]->nameLength) == expected[i];
+        }
+    }
+    cout << "After 20000 inserts and removes the prefix index " << (same ? "matches" : "DOES NOT MATCH")
+         << " a full scan\n";
+    cout.unsetf(ios::fixed);
+}
+
+// Memory used by a catalog of n drinks with 3 types, split by part, next to what the same
+// catalog took when every node carried the type as a string pointer plus a TypeEntry pointer
+// (and its own key pointer, freelist link and 64-bit row): 96 bytes a node instead of 64.
+void runMemoryReport(size_t n) {
+    struct OldDrinkLayout {    // Drink before types were stored as IDs
+        const char* name;
+        const char* type;
+        double price;
+        int stock;
+        const char* key;
+        size_t nameLength;
+        uint64_t hash;
+        Drink* nextFree;
+        TypeEntry* typeEntry;
+        Drink* prevOfType;
+        Drink* nextOfType;
+        size_t row;
+    };
+    const char* typeNames[] = {"Beverage", "Juice", "Tea"};
+    HashTable shop;
+    shop.reserve(n);
+    char name[32];
+    for (size_t i = 0; i < n; i++) {
+        size_t len = snprintf(name, sizeof(name), "Drink%zu", i);
+        shop.insert(string_view(name, len), typeNames[i % 3], 5 + (i % 40) * 0.5, i % 500);
+    }
+    MemoryFootprint m = shop.memoryFootprint();
+    size_t oldNodes = n * sizeof(OldDrinkLayout);
+    size_t newNodes = n * sizeof(Drink);
+    size_t oldTotal = m.total() - newNodes + oldNodes;
+    const double MB = 1024.0 * 1024.0;
+    
+    cout << "Memory footprint of " << n << " drinks\n";
+    cout << "--------------------------------------------------------------\n";
+    cout << "| Part                         | MB           | Bytes/drink  |\n";
+    cout << "--------------------------------------------------------------\n";
+    const char* parts[] = {"Arena (nodes, names, types)", "Slots", "Columns", "Type dictionary"};
+    size_t bytes[] = {m.arena, m.slots, m.columns, m.types};
+    cout << fixed << setprecision(1);
+    for (int p = 0; p < 4; p++) {
+        cout << "| " << setw(29) << left << parts[p] << "| " << setw(13) << bytes[p] / MB
+             << "| " << setw(13) << (double)bytes[p] / n << "|\n";
+        if (p == 0) {
+            cout << "| " << setw(29) << "  of which Drink nodes" << "| " << setw(13) << newNodes / MB
+                 << "| " << setw(13) << (double)sizeof(Drink) << "|\n";
+        }
+    }
+    cout << "--------------------------------------------------------------\n";
+    cout << "| " << setw(29) << "Total" << "| " << setw(13) << m.total() / MB
+         << "| " << setw(13) << (double)m.total() / n << "|\n";
+    cout << "| " << setw(29) << "Total with the old nodes" << "| " << setw(13) << oldTotal / MB
+         << "| " << setw(13) << (double)oldTotal / n << "|\n";
+    cout << "--------------------------------------------------------------\n";
+    cout << "Drink node: " << sizeof(OldDrinkLayout) << " bytes before, " << sizeof(Drink) << " bytes now, "
+         << setprecision(1) << 100.0 * (oldTotal - m.total()) / oldTotal << "% less memory in total\n";
+    cout.unsetf(ios::fixed);
 }
 
-class HashTable {
-private:
-    Drink* table[TABLE_SIZE];  // Array of pointers to linked lists
+// Throughput of every kernel set this CPU supports, in millions of rows per second, on a
+// cache-sized 64K rows and on `rows` rows straight from memory. Results are checked against
+// the scalar kernels.
+void runSimdBenchmark(size_t rows) {
+    const size_t TYPES = 3;
+    const int LOW_STOCK = 20;
+    const double LOW_PRICE = 10, HIGH_PRICE = 15;
+    vector<ScanKernels> sets = availableScanKernels();
+    const ScanKernels& scalar = sets.back();
+    const char* queryNames[] = {"stock value", "low stock", "price range", "per type"};
     
-	// Simple hash function: sum ASCII values of lowercase letters and mod table size
-    int hashFunction(const string& key) {
-    	string lowerKey = toLower(key);
-        int hash = 0;
-        for (size_t i = 0; i < lowerKey.length(); i++) {
-            hash += (int)lowerKey[i];  // Add ASCII value of each character
+    cout << "SIMD scan benchmark (million rows per second)\n";
+    cout << "--------------------------------------------------------------------------------\n";
+    cout << "| Rows       | Kernels  | Stock value  | Low stock    | Price range  | Per type     |\n";
+    cout << "--------------------------------------------------------------------------------\n";
+    size_t sizes[] = {65536, rows};
+    bool allSame = true;
+    for (int s = 0; s < 2; s++) {
+        size_t n = sizes[s];
+        vector<double> price(n);
+        vector<int> stock(n);
+        vector<uint32_t> typeId(n);
+        mt19937 rng(16);
+        for (size_t i = 0; i < n; i++) {
+            price[i] = 5 + (rng() % 40) * 0.5;
+            stock[i] = rng() % 500;
+            typeId[i] = rng() % TYPES;
+        }
+        vector<uint32_t> out(n);
+        size_t rounds = max((size_t)1, (size_t)200000000 / n);   // About 200M rows per measurement
+        
+        double expectedValue = scalar.stockValue(price.data(), stock.data(), n);
+        size_t expectedLow = scalar.lowStock(stock.data(), n, LOW_STOCK, out.data());
+        size_t expectedBand = scalar.priceRange(price.data(), n, LOW_PRICE, HIGH_PRICE, out.data());
+        size_t expectedCounts[TYPES] = {};
+        scalar.countPerType(typeId.data(), n, expectedCounts, TYPES);
+        size_t counts[TYPES];
+        
+        for (size_t k = 0; k < sets.size(); k++) {
+            const ScanKernels& set = sets[k];
+            cout << "| " << setw(11) << left << (k == 0 ? to_string(n) : "") << "| " << setw(9) << set.name;
+            for (int query = 0; query < 4; query++) {
+                bool same = true;
+                auto t0 = chrono::steady_clock::now();
+                for (size_t r = 0; r < rounds; r++) {
+                    if (query == 0) {
+                        double value = set.stockValue(price.data(), stock.data(), n);
+                        same = fabs(value - expectedValue) <= 1e-9 * expectedValue;
+                    } else if (query == 1) {
+                        same = set.lowStock(stock.data(), n, LOW_STOCK, out.data()) == expectedLow;
+                    } else if (query == 2) {
+                        same = set.priceRange(price.data(), n, LOW_PRICE, HIGH_PRICE, out.data()) == expectedBand;
+                    } else {
+                        fill(counts, counts + TYPES, 0);
+                        set.countPerType(typeId.data(), n, counts, TYPES);
+                        same = equal(counts, counts + TYPES, expectedCounts);
+                    }
+                }
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+                cout << "| " << setw(13) << fixed << setprecision(0) << (double)n * rounds / seconds / 1e6;
+                if (!same) {
+                    cout << "\n  " << set.name << " " << queryNames[query] << " does not match the scalar result\n";
+                    allSame = false;
+                }
+            }
+            cout << "|\n";
         }
-        return hash % TABLE_SIZE;  // Get index within table size
     }
+    cout << "--------------------------------------------------------------------------------\n";
+    cout << (allSame ? "All kernel sets match the scalar results" : "MISMATCH against the scalar results")
+         << ", the table uses " << scanKernels().name << "\n";
+    cout.unsetf(ios::fixed);
+}
+
+// Throughput of a ConcurrentHashTable shared by 1..maxThreads threads, with one stripe (a
+// single reader/writer lock over the whole table) and with LOCK_STRIPES stripes. Each
+// thread runs its own random mix of lookups and writes (inserts and removes over twice the
+// starting names, so about half of them hit). Afterwards the table size has to equal the
+// starting size plus the drinks the threads added minus the ones they removed.
+void runConcurrentBenchmark(unsigned maxThreads) {
+    const size_t N = 200000;
+    const size_t OPS = 400000;    // Per run, split over the threads
+    struct Workload {
+        const char* label;
+        int readPercent;
+    };
+    const Workload workloads[] = {{"read-heavy", 95}, {"write-heavy", 50}};
+    const size_t stripeCounts[] = {1, LOCK_STRIPES};
     
+    vector<string> names(2 * N);
+    for (size_t i = 0; i < names.size(); i++) {
+        names[i] = "Drink" + to_string(i);
+    }
     
-public:
-    HashTable() {   //When a HashTable is created, this sets all entries in the table to NULL (empty)
-        for (int i = 0; i < TABLE_SIZE; i++) {
-            table[i] = NULL;  
+    cout << "Concurrent table benchmark: " << N << " drinks, " << OPS << " operations per run, "
+         << thread::hardware_concurrency() << " hardware threads\n";
+    cout << "----------------------------------------------------------\n";
+    cout << "| Workload     | Stripes | Threads | Mops/s    | Size ok |\n";
+    cout << "----------------------------------------------------------\n";
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++) {
+        for (size_t s = 0; s < sizeof(stripeCounts) / sizeof(stripeCounts[0]); s++) {
+            for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+                ConcurrentHashTable shop(stripeCounts[s]);
+                for (size_t i = 0; i < N; i++) {
+                    shop.insert(names[i], "Tea", 10, 100);
+                }
+                vector<long long> added(threads, 0);
+                vector<thread> workers;
+                auto start = chrono::steady_clock::now();
+                for (unsigned t = 0; t < threads; t++) {
+                    workers.push_back(thread([&, t]() {
+                        mt19937 rng(t + 1);
+                        DrinkInfo info;
+                        long long net = 0;
+                        for (size_t op = 0; op < OPS / threads; op++) {
+                            const string& name = names[rng() % names.size()];
+                            int r = rng() % 100;
+                            if (r < workloads[w].readPercent) {
+                                shop.find(name, info);
+                            } else if (r % 2 == 0) {
+                                net += shop.insert(name, "Juice", 12, 50) ? 1 : 0;
+                            } else {
+                                net -= shop.remove(name) ? 1 : 0;
+                            }
+                        }
+                        added[t] = net;
+                    }));
+                }
+                for (size_t t = 0; t < workers.size(); t++) {
+                    workers[t].join();
+                }
+                double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                long long expected = N;
+                for (unsigned t = 0; t < threads; t++) {
+                    expected += added[t];
+                }
+                cout << "| " << setw(13) << left << workloads[w].label
+                     << "| " << setw(8) << stripeCounts[s]
+                     << "| " << setw(8) << threads
+                     << "| " << setw(10) << fixed << setprecision(2) << (double)(OPS / threads * threads) / seconds / 1e6
+                     << "| " << setw(8) << ((long long)shop.size() == expected ? "yes" : "NO") << "|\n";
+            }
         }
     }
+    cout << "----------------------------------------------------------\n";
+    cout.unsetf(ios::fixed);
+}
 
-    ~HashTable() {    //When the program ends, this deletes all drinks in every table slot to free memory.
-        for (int i = 0; i < TABLE_SIZE; i++) {
-            Drink* current = table[i];        // Start with the first drink in the list
-            while (current != NULL) {        // While there's a drink in the list
-                Drink* temp = current;      // While there's a drink in the list
-                current = current->next;   // Move to the next drink
-                delete temp;		 	 // Delete current drink to free memory
-            }
-        }
+// Load generator for the order path: clients threads each place orders (1 to 4 lines of 1 to
+// 3 drinks each) back to back against a ConcurrentHashTable, every order waiting until its
+// journal record is durable, for 1, 4, 16, ... up to maxClients clients. Stock runs out as
+// the run goes on, so some orders are refused. Afterwards the journal is replayed over the
+// starting catalog and must give the same stock as the table.
+void runOrderBenchmark(unsigned maxClients) {
+    const size_t DRINKS = 5000;
+    const size_t ORDERS = 20000;      // Per run, split over the clients
+    const int START_STOCK = 20;
+    const string journalFile = "order_bench.journal";
+    const char* types[] = {"Tea", "Juice", "Coffee"};
+    
+    vector<string> names(DRINKS);
+    for (size_t i = 0; i < DRINKS; i++) {
+        names[i] = "Drink" + to_string(i);
     }
     
-    // Insert a new drink or update if it already exists in the hash table
-    void insert(const string& name, const string& type, double price, int stock) {
-        int index = hashFunction(name);      // Compute hash index based on drink name
-    	Drink* current = table[index];          
-		string lowerName = toLower(name);
-		
-		
-    	// Check if drink already exists to update
-        while (current != NULL) {         
-            if (toLower(current->name) == lowerName) {
-                current->type = type;
-                current->price = price;
-                current->stock = stock;
-                return;
+    cout << "Order benchmark: " << DRINKS << " drinks, " << ORDERS << " orders per run, each durable before it returns\n";
+    cout << "-----------------------------------------------------------------------------------------\n";
+    cout << "| Clients | Orders/s  | p50 (us)  | p99 (us)  | Refused | Orders/fsync | Replay matches |\n";
+    cout << "-----------------------------------------------------------------------------------------\n";
+    for (unsigned clients = 1; clients <= maxClients; clients *= 4) {
+        std::remove(journalFile.c_str());
+        std::remove((journalFile + ".old").c_str());
+        ConcurrentHashTable shop;
+        for (size_t i = 0; i < DRINKS; i++) {
+            shop.insert(names[i], types[i % 3], 5 + i % 10, START_STOCK);
+        }
+        size_t syncsBefore = 0;
+        vector<vector<double> > latencies(clients);
+        vector<size_t> refused(clients, 0);
+        double seconds = 0;
+        {
+            Journal journal("order_bench_snapshot.txt", journalFile);
+            HashTable empty;
+            journal.recover(empty);     // Opens the journal for appending
+            syncsBefore = journal.syncCount();
+            vector<thread> workers;
+            auto start = chrono::steady_clock::now();
+            for (unsigned c = 0; c < clients; c++) {
+                workers.push_back(thread([&, c]() {
+                    mt19937 rng(c + 1);
+                    vector<OrderLine> lines;
+                    for (size_t o = 0; o < ORDERS / clients; o++) {
+                        lines.resize(1 + rng() % 4);
+                        for (size_t l = 0; l < lines.size(); l++) {
+                            lines[l].name = names[rng() % DRINKS];
+                            lines[l].quantity = 1 + rng() % 3;
+                        }
+                        auto o0 = chrono::steady_clock::now();
+                        uint64_t number = 0;
+                        OrderResult result = shop.placeOrder(lines, [&](const string& record) {
+                            number = journal.logOrder(record);
+                        });
+                        if (result.filled && !journal.waitDurable(number)) {
+                            shop.cancelOrder(lines);
+                            result.filled = false;
+                        }
+                        if (!result.filled) {
+                            refused[c]++;
+                        }
+                        latencies[c].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - o0).count());
+                    }
+                }));
             }
-            current = current->next;     // Move to next drink in list
+            for (size_t c = 0; c < workers.size(); c++) {
+                workers[c].join();
+            }
+            seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            syncsBefore = journal.syncCount() - syncsBefore;
         }
         
-        // If not found, insert new drink at head of list
-        Drink* newDrink = new Drink(name, type, price, stock);   
-        newDrink->next = table[index];
-        table[index] = newDrink;
-    }
-    
-    Drink* search(const string& name) {
-        int index = hashFunction(name);   //Calculate hash index using the drink name
-        Drink* current = table[index];   //Start at the linked list head at that index
-        string lowerName = toLower(name);
+        vector<double> all;
+        size_t refusedTotal = 0;
+        for (unsigned c = 0; c < clients; c++) {
+            all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+            refusedTotal += refused[c];
+        }
+        sort(all.begin(), all.end());
         
-        while (current != NULL) {       //Loop through the linked list
-            if (toLower(current->name) == lowerName) {    //If drink found, return pointer to it
-                return current;
-            }
-            current = current->next;
+        // Replay the journal over the starting catalog and compare every drink
+        HashTable replayed;
+        for (size_t i = 0; i < DRINKS; i++) {
+            replayed.insert(names[i], types[i % 3], 5 + i % 10, START_STOCK);
         }
-        return NULL;
-    }
-    	
-    bool remove(const string& name) {
-        int index = hashFunction(name);
-        Drink* current = table[index];
-        Drink* prev = NULL;   //Keep track of previous node (for remove)
-        string lowerName = toLower(name);
-
-        while (current != NULL) {   //Traverse linked list
-            if (toLower(current->name) == lowerName) {
-                if (prev == NULL) {     //If it's the first node in the list,
-                    table[index] = current->next;   // remove it by changing head pointer
-                } else {
-                    prev->next = current->next;    // bypass current node
-                }
-                delete current;   // Free memory
-                return true;
-            }
-            prev = current;
-            current = current->next;
+        {
+            Journal journal("order_bench_snapshot.txt", journalFile);
+            journal.recover(replayed);
         }
-        return false;
+        bool same = true;
+        DrinkInfo info;
+        for (size_t i = 0; i < DRINKS && same; i++) {
+            same = shop.find(names[i], info) && replayed.search(names[i])->stock == info.stock && info.stock >= 0;
+        }
+        
+        cout << "| " << setw(8) << left << clients
+             << "| " << setw(10) << fixed << setprecision(0) << all.size() / seconds
+             << "| " << setw(10) << setprecision(1) << all[all.size() / 2]
+             << "| " << setw(10) << all[all.size() * 99 / 100]
+             << "| " << setw(8) << refusedTotal
+             << "| " << setw(13) << (double)(all.size() - refusedTotal) / max((size_t)1, syncsBefore)
+             << "| " << setw(15) << (same ? "yes" : "NO") << "|\n";
     }
+    cout << "-----------------------------------------------------------------------------------------\n";
+    cout.unsetf(ios::fixed);
+    std::remove(journalFile.c_str());
+}
+
+// Cross-outlet queries on an OutletCatalog of about a million drink rows in total, split over
+// 1, 2, 4, ... up to maxOutlets outlets (every outlet lists the same menu with its own stock),
+// once with the queries running on the calling thread and once on a pool of one worker per
+// hardware thread.
+void runOutletBenchmark(size_t maxOutlets) {
+    const size_t ROWS = 1000000;
+    const int LOOKUPS = 1000;
+    const int SCANS = 10;
+    const char* types[] = {"Tea", "Juice", "Coffee"};
+    unsigned hardware = max(1u, thread::hardware_concurrency());
     
-    void update(const string& name,const string& newType, double newPrice, int newStock) {
-        Drink* d = search(name);
-        string lowerName = toLower(name);
-        if (d != NULL) {
-        	d->type = newType;
-            d->price = newPrice;  //Update the price
-            d->stock = newStock;
-            cout << "Drink details updated.\n";
-    	} else {
-        	cout << "Drink not found.\n";
+    cout << "Outlet benchmark: " << ROWS << " drink rows in total, pool of " << hardware << " threads\n";
+    cout << "---------------------------------------------------------------------------------------------------------\n";
+    cout << "| Outlets | Drinks/outlet | Threads | Drink total (us) | Low on type (us) | Low stock (ms) | Value (ms) |\n";
+    cout << "---------------------------------------------------------------------------------------------------------\n";
+    for (size_t outlets = 1; outlets <= maxOutlets; outlets *= 2) {
+        size_t menu = ROWS / outlets;
+        vector<string> names(menu);
+        for (size_t i = 0; i < menu; i++) {
+            names[i] = "Drink" + to_string(i);
+        }
+        for (int pooled = 0; pooled < 2; pooled++) {
+            OutletCatalog catalog(pooled ? hardware : 0);
+            mt19937 rng(22);
+            for (size_t o = 0; o < outlets; o++) {
+                size_t outlet = catalog.addOutlet("Outlet" + to_string(o));
+                for (size_t i = 0; i < menu; i++) {
+                    catalog.insert(outlet, names[i], types[i % 3], 5 + i % 10, rng() % 100);
+                }
+            }
+            
+            long long checksum = 0;
+            auto t0 = chrono::steady_clock::now();
+            for (int q = 0; q < LOOKUPS; q++) {
+                checksum += catalog.totalStock(names[rng() % menu]);
+            }
+            auto t1 = chrono::steady_clock::now();
+            for (int q = 0; q < LOOKUPS; q++) {
+                checksum += catalog.outletsLowOn(types[q % 3], 100 * (long long)menu / 6).size();
+            }
+            auto t2 = chrono::steady_clock::now();
+            for (int q = 0; q < SCANS; q++) {
+                checksum += catalog.lowStock(5).size();
+            }
+            auto t3 = chrono::steady_clock::now();
+            double value = 0;
+            for (int q = 0; q < SCANS; q++) {
+                value += catalog.totalStockValue();
+            }
+            auto t4 = chrono::steady_clock::now();
+            
+            cout << "| " << setw(8) << left << outlets
+                 << "| " << setw(14) << menu
+                 << "| " << setw(8) << (pooled ? hardware : 0)
+                 << "| " << setw(17) << fixed << setprecision(1) << chrono::duration<double, micro>(t1 - t0).count() / LOOKUPS
+                 << "| " << setw(17) << chrono::duration<double, micro>(t2 - t1).count() / LOOKUPS
+                 << "| " << setw(15) << chrono::duration<double, milli>(t3 - t2).count() / SCANS
+                 << "| " << setw(11) << chrono::duration<double, milli>(t4 - t3).count() / SCANS << "|\n";
+            if (checksum < 0 || value < 0) {
+                cout << "impossible\n";    // Keeps the query results alive
+            }
         }
     }
-    
-    void displayAll() {
-    cout << "\n                        Drink List                         \n";
-    cout << "-------------------------------------------------------------\n";
-    cout << "| Name               | Type         | Price (RM) | Stock    |\n";
-    cout << "-------------------------------------------------------------\n";
+    cout << "---------------------------------------------------------------------------------------------------------\n";
+    cout << "Threads 0: queries run on the calling thread, one outlet after another\n";
+    cout.unsetf(ios::fixed);
+}
 
-    for (int i = 0; i < TABLE_SIZE; i++) {
-        Drink* current = table[i];
-        while (current) {
-            cout << "| " << setw(18) << left << current->name
-                 << "| " << setw(13) << left << current->type
-                 << "| " << setw(10) << fixed << setprecision(2) << current->price
-                 << "| " << setw(10) << current->stock
-                 << "|\n";
-            current = current->next;
+#ifdef HAVE_CATALOG_SERVICE
+// Reads exactly n bytes, false if the connection closed first
+bool readFully(int fd, char* p, size_t n) {
+    while (n > 0) {
+        long got = ::read(fd, p, n);
+        if (got <= 0) {
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
         }
+        p += got;
+        n -= got;
     }
-	cout << "-------------------------------------------------------------\n";   
+    return true;
 }
-    
-    void displayByType(const string& queryType) {
-    	string lowerType = toLower(queryType);
-    	bool found = false;
-    	
-    		cout << "\n                  Drinks of type \"" << queryType << "\"   \n";
-			cout << "-------------------------------------------------------------\n";
-    		cout << "| Name               | Type         | Price (RM) | Stock    |\n";
-    		cout << "-------------------------------------------------------------\n";
-    		
-    		for (int i = 0; i < TABLE_SIZE; ++i) {
-        		Drink* current = table[i];
-        		while (current) {
-            		if (toLower(current->type) == lowerType) {
-                		cout << "| " << setw(19) << left << current->name
-                     		 << "| " << setw(13) << left << current->type
-                     		 << "| " << setw(10) << fixed << setprecision(2) << current->price
-                     		 << "| " << setw(10) << current->stock
-                     		 << "|\n";
-                		found = true;
-            		}
-            		current = current->next;
-        		}
-        	}
-			cout << "-------------------------------------------------------------\n";
-    	if (!found) {
-    		cout << "No drinks found for the type.\n";
-    	}
-	}
-    
-    void loadFromFile(const string& filename) {  
-        cout << "Loading drink data from file...\n";      // Inform user that program is searching for the file
 
-        ifstream fin(filename.c_str());   // Open file for reading
-        if (!fin) {
-            cout << "Unable to find file: " << filename << endl;
-            return;
+bool writeFully(int fd, const string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        long n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
         }
-        string name, type;
-        double price;
-        int stock;
+        done += n;
+    }
+    return true;
+}
 
-        while (fin >> name >> type >> price >> stock) {
-            cout << "Loaded: " << name << ", " << type << ", " << price << ", " << stock << endl;
-            insert(name, type, price, stock);    // Add each drink to the hash table
-        }
+// Appends one request frame
+void putRequest(string& out, int op, string_view name, string_view type = string_view(), double price = 0, int stock = 0) {
+    size_t start = out.size();
+    out.append(4, '\0');
+    out += (char)op;
+    if (op == OP_INSERT || op == OP_UPDATE) {
+        putDouble(out, price);
+        putNumber(out, (uint32_t)stock, 4);
+        putNumber(out, name.size(), 2);
+        out.append(name.data(), name.size());
+        out.append(type.data(), type.size());
+    } else {
+        out.append(name.data(), name.size());
+    }
+    size_t length = out.size() - start - 4;
+    for (size_t i = 0; i < 4; i++) {
+        out[start + i] = (char)(length >> (8 * i));
+    }
+}
 
-        fin.close();
-        cout << "Data loaded from " << filename << endl;  // Inform user loading is done
+// Reads one answer frame's body, false if the connection closed
+bool readAnswer(int fd, string& body) {
+    char header[4];
+    if (!readFully(fd, header, 4)) {
+        return false;
     }
+    WireReader r(header, header + 4);
+    body.resize(r.number(4));
+    return readFully(fd, &body[0], body.size());
+}
+
+// Load-test client for the catalog service (--serve). Every connection runs on its own thread
+// with its own 1000 drinks (type "LoadTest<n>"), so it knows what each answer must be. It
+// sends a batch of depth requests at a time (80% search, 10% update, 6% insert, 3% remove,
+// 1% list of its type) and reads the depth answers back; a request's latency runs from
+// sending its batch to reading its answer. Runs for the given seconds at pipeline depths
+// 1, 8 and 64, then removes its drinks again.
+void runServiceLoadTest(const string& address, unsigned connections, double seconds) {
+    const size_t OWN = 1000;
+    const size_t depths[] = {1, 8, 64};
     
-    void saveToFile(const string& filename) {
-        ofstream fout(filename.c_str());  // Open file for writing
-        if (!fout) {             // Check if file opened successfully
-            cout << "Cannot open file to save: " << filename << endl;
+    cout << "Load test against " << address << ": " << connections << " connections, " << seconds << " s per depth\n";
+    cout << "-----------------------------------------------------------------------------------\n";
+    cout << "| Depth | Requests  | Requests/s | p50 (us)  | p99 (us)  | p99.9 (us) | Wrong answers |\n";
+    cout << "-----------------------------------------------------------------------------------\n";
+    for (size_t run = 0; run < sizeof(depths) / sizeof(depths[0]); run++) {
+        size_t depth = depths[run];
+        vector<vector<double> > latencies(connections);
+        vector<size_t> wrong(connections, 0);
+        vector<int> failed(connections, 0);
+        vector<thread> clients;
+        auto start = chrono::steady_clock::now();
+        auto stop = start + chrono::duration<double>(seconds);
+        for (unsigned c = 0; c < connections; c++) {
+            clients.push_back(thread([&, c]() {
+                int fd = openServiceSocket(address, false);
+                if (fd < 0) {
+                    failed[c] = 1;
+                    return;
+                }
+                string type = "LoadTest" + to_string(c);
+                vector<string> names(OWN);
+                vector<char> present(OWN, 0);
+                size_t presentCount = 0;
+                string batch, body;
+                for (size_t i = 0; i < OWN; i++) {
+                    names[i] = "Load" + to_string(c) + "_" + to_string(i);
+                    putRequest(batch, OP_INSERT, names[i], type, 5, 10);
+                }
+                if (!writeFully(fd, batch)) {
+                    failed[c] = 1;
+                }
+                for (size_t i = 0; i < OWN && !failed[c]; i++) {
+                    failed[c] = !readAnswer(fd, body);
+                    present[i] = 1;
+                }
+                presentCount = OWN;
+                
+                mt19937 rng(c * 7 + run);
+                vector<int> ops(depth);
+                vector<size_t> targets(depth);
+                vector<char> expectFound(depth);
+                while (!failed[c] && chrono::steady_clock::now() < stop) {
+                    batch.clear();
+                    for (size_t k = 0; k < depth; k++) {
+                        size_t i = rng() % OWN;
+                        int r = rng() % 100;
+                        int op = r < 80 ? OP_SEARCH : r < 90 ? OP_UPDATE : r < 96 ? OP_INSERT : r < 99 ? OP_REMOVE : OP_LIST_TYPE;
+                        ops[k] = op;
+                        targets[k] = i;
+                        expectFound[k] = present[i];
+                        if (op == OP_INSERT) {
+                            presentCount += present[i] ? 0 : 1;
+                            present[i] = 1;
+                        } else if (op == OP_REMOVE) {
+                            presentCount -= present[i] ? 1 : 0;
+                            present[i] = 0;
+                        } else if (op == OP_LIST_TYPE) {
+                            targets[k] = presentCount;   // Expected count, as of this point in the batch
+                        }
+                        putRequest(batch, op, op == OP_LIST_TYPE ? string_view(type) : string_view(names[i]), type, 6, 20);
+                    }
+                    auto sent = chrono::steady_clock::now();
+                    if (!writeFully(fd, batch)) {
+                        failed[c] = 1;
+                        break;
+                    }
+                    for (size_t k = 0; k < depth; k++) {
+                        if (!readAnswer(fd, body)) {
+                            failed[c] = 1;
+                            break;
+                        }
+                        latencies[c].push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - sent).count());
+                        WireReader r(body.data(), body.data() + body.size());
+                        int status = (int)r.number(1);
+                        bool right;
+                        if (ops[k] == OP_SEARCH || ops[k] == OP_UPDATE || ops[k] == OP_REMOVE) {
+                            right = status == (expectFound[k] ? STATUS_OK : STATUS_NOT_FOUND);
+                        } else if (ops[k] == OP_INSERT) {
+                            right = status == STATUS_OK && (int)r.number(1) == (expectFound[k] ? 0 : 1);
+                        } else {
+                            right = status == STATUS_OK && r.number(4) == targets[k];
+                        }
+                        wrong[c] += right ? 0 : 1;
+                    }
+                }
+                
+                batch.clear();
+                size_t removes = 0;
+                for (size_t i = 0; i < OWN; i++) {
+                    if (present[i]) {
+                        putRequest(batch, OP_REMOVE, names[i]);
+                        removes++;
+                    }
+                }
+                if (!failed[c] && writeFully(fd, batch)) {
+                    for (size_t i = 0; i < removes && readAnswer(fd, body); i++) {
+                    }
+                }
+                ::close(fd);
+            }));
+        }
+        for (size_t c = 0; c < clients.size(); c++) {
+            clients[c].join();
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        
+        vector<double> all;
+        size_t wrongTotal = 0;
+        int failures = 0;
+        for (unsigned c = 0; c < connections; c++) {
+            all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+            wrongTotal += wrong[c];
+            failures += failed[c];
+        }
+        if (all.empty()) {
+            cout << "No requests were answered (" << failures << " connections failed)\n";
             return;
         }
-        for (int i = 0; i < TABLE_SIZE; i++) {
-            Drink* current = table[i];
-            while (current != NULL) {
-                fout << current->name << " " << current->type << " " << current->price << " " << current->stock << "\n";
-                current = current->next;
-            }
+        sort(all.begin(), all.end());
+        cout << "| " << setw(6) << left << depth
+             << "| " << setw(10) << all.size()
+             << "| " << setw(11) << fixed << setprecision(0) << all.size() / elapsed
+             << "| " << setw(10) << setprecision(1) << all[all.size() / 2]
+             << "| " << setw(10) << all[all.size() * 99 / 100]
+             << "| " << setw(11) << all[all.size() * 999 / 1000]
+             << "| " << setw(14) << wrongTotal << "|\n";
+        if (failures > 0) {
+            cout << failures << " connections failed or were closed by the service\n";
         }
-        fout.close();
-        cout << "Changes saved to " << filename << endl;
     }
-};
-
-void pause() {
-    cout << "\nPress Enter to continue...";
-    cin.ignore(numeric_limits<streamsize>::max(), '\n');  //Clears any leftover input from the user 
-    cin.get();
+    cout << "-----------------------------------------------------------------------------------\n";
+    cout.unsetf(ios::fixed);
 }
+#endif
 
-void clearScreen() {
-#ifdef _WIN32
-    system("cls");
+#ifdef MIXUE_STATS
+const bool STATS_COMPILED_IN = true;
 #else
-    system("clear");
+const bool STATS_COMPILED_IN = false;
 #endif
+const char* const STATS_FILE = "mixue_stats.json";
+
+// [[length, count], ...] for the non-zero entries; the last length means "this long or longer"
+void appendLengths(string& out, const vector<size_t>& lengths) {
+    out += "[";
+    bool first = true;
+    for (size_t n = 0; n < lengths.size(); n++) {
+        if (lengths[n] > 0) {
+            out += (first ? "[" : ", [") + to_string(n) + ", " + to_string(lengths[n]) + "]";
+            first = false;
+        }
+    }
+    out += "]";
 }
 
-// Ask user for an integer input with validation
-int getValidatedInt(const string& prompt) {
-    int value;
-    while (true) {
-        cout << prompt;
-        if (cin >> value) {
-            cin.ignore(numeric_limits<streamsize>::max(), '\n'); 
-            return value;
-        } else {
-            cout << "Invalid input. Please enter a valid integer.\n";
-            cin.clear();
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+// Everything the statistics menu shows, as JSON, for scripts and dashboards to read.
+// Histogram buckets are [largest value in the bucket (ns), count], non-empty buckets only.
+string statsJson(const TableHealth& h) {
+    ostringstream out;
+    out << fixed << setprecision(3);
+    out << "{\n  \"stats_compiled_in\": " << (STATS_COMPILED_IN ? "true" : "false") << ",\n";
+    out << "  \"table\": {\"drinks\": " << h.drinks << ", \"slots\": " << h.slots
+        << ", \"load_factor\": " << (h.slots == 0 ? 0.0 : (double)h.drinks / h.slots)
+        << ", \"mean_probe\": " << h.meanProbe << ", \"longest_probe\": " << h.longestProbe
+        << ", \"mean_cluster\": " << h.meanCluster << ", \"longest_cluster\": " << h.longestCluster << ",\n";
+    string lengths;
+    appendLengths(lengths, h.probeLengths);
+    out << "    \"probe_lengths\": " << lengths << ",\n";
+    lengths.clear();
+    appendLengths(lengths, h.clusterLengths);
+    out << "    \"cluster_lengths\": " << lengths << "},\n";
+    out << "  \"probes\": {\"lookups\": " << probeLookups.load() << ", \"slots_looked_at\": " << probeSteps.load() << "},\n";
+    out << "  \"operations\": {";
+    for (int op = 0; op < STAT_OPS; op++) {
+        const LatencyHistogram& l = opLatency[op];
+        out << (op == 0 ? "\n" : ",\n") << "    \"" << STAT_OP_NAMES[op] << "\": {\"count\": " << l.count()
+            << ", \"mean_ns\": " << l.mean() << ", \"p50_ns\": " << l.percentile(0.5)
+            << ", \"p90_ns\": " << l.percentile(0.9) << ", \"p99_ns\": " << l.percentile(0.99)
+            << ", \"p999_ns\": " << l.percentile(0.999) << ", \"max_ns\": " << l.max() << ",\n      \"buckets\": [";
+        bool first = true;
+        for (int b = 0; b < LatencyHistogram::bucketCount(); b++) {
+            if (l.countAt(b) > 0) {
+                out << (first ? "[" : ", [") << LatencyHistogram::bucketTop(b) << ", " << l.countAt(b) << "]";
+                first = false;
+            }
         }
+        out << "]}";
     }
+    out << "\n  }\n}\n";
+    return out.str();
 }
 
-// Ask user for a number input with validation
-double getValidatedDouble(const string& prompt) {
-    double value;
-    while (true) {
-        cout << prompt;
-        if (cin >> value) {
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-            return value;
-        } else {
-            cout << "Invalid input. Please enter a valid number.\n";
-            cin.clear();
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+bool writeStatsDump(const HashTable& shop) {
+    return writeFileAtomically(STATS_FILE, statsJson(shop.health()));
+}
+
+// Microseconds from nanoseconds, for the statistics table
+string microseconds(double ns) {
+    ostringstream out;
+    out << fixed << setprecision(ns < 10000 ? 2 : 0) << ns / 1000;
+    return out.str();
+}
+
+void showStatistics(const HashTable& shop) {
+    TableHealth h = shop.health();
+    cout << "Statistics\n\n";
+    cout << "Drinks: " << h.drinks << " in " << h.slots << " slots (load " << fixed << setprecision(2)
+         << (h.slots == 0 ? 0.0 : (double)h.drinks / h.slots) << ")\n";
+    cout << "Probe length: mean " << h.meanProbe << ", longest " << h.longestProbe << "\n";
+    cout << "Cluster length: mean " << h.meanCluster << ", longest " << h.longestCluster << "\n\n";
+    cout << "Probe lengths (slots a search for an existing drink looks at):\n";
+    for (size_t n = 1; n < h.probeLengths.size(); n++) {
+        if (h.probeLengths[n] > 0) {
+            cout << "  " << setw(3) << right << n << (n == TableHealth::TOP ? "+" : " ") << setw(10) << h.probeLengths[n]
+                 << "  " << setw(6) << 100.0 * h.probeLengths[n] / h.drinks << "%\n";
         }
     }
+    cout << left << "\n";
+    if (!STATS_COMPILED_IN) {
+        cout << "Latency histograms are not compiled in, rebuild with -DMIXUE_STATS to record them.\n";
+    } else {
+        if (probeLookups.load() > 0) {
+            cout << "Lookups: " << probeLookups.load() << ", mean slots looked at "
+                 << (double)probeSteps.load() / probeLookups.load() << "\n\n";
+        }
+        cout << "-----------------------------------------------------------------------------------------\n";
+        cout << "| Operation    | Count      | Mean (us) | p50 (us)  | p99 (us)  | p999 (us) | Max (us)  |\n";
+        cout << "-----------------------------------------------------------------------------------------\n";
+        for (int op = 0; op < STAT_OPS; op++) {
+            const LatencyHistogram& l = opLatency[op];
+            cout << "| " << setw(13) << STAT_OP_NAMES[op] << "| " << setw(11) << l.count()
+                 << "| " << setw(10) << microseconds(l.mean()) << "| " << setw(10) << microseconds(l.percentile(0.5))
+                 << "| " << setw(10) << microseconds(l.percentile(0.99)) << "| " << setw(10) << microseconds(l.percentile(0.999))
+                 << "| " << setw(10) << microseconds(l.max()) << "|\n";
+        }
+        cout << "-----------------------------------------------------------------------------------------\n";
+    }
+    cout.unsetf(ios::fixed);
+    if (writeStatsDump(shop)) {
+        cout << "\nWritten to " << STATS_FILE << "\n";
+    } else {
+        cout << "\nCould not write " << STATS_FILE << "\n";
+    }
 }
 
-void manageItemsMenu(HashTable& shop);
+// Last modification time of a file, 0 if it does not exist
+time_t fileModifiedTime(const string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+    return st.st_mtime;
+}
 
-int main() {
+void manageItemsMenu(HashTable& shop, Journal& journal);
+void placeOrderMenu(HashTable& shop, Journal& journal);
+
+#ifndef MIXUE_LIBRARY
+int main(int argc, char* argv[]) {
+    if (argc > 1 && string(argv[1]) == "--bench-lookup") {
+        runLookupBenchmark();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-load") {
+        runLoadBenchmark();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-parallel") {
+        runParallelLoadBenchmark(argc > 2 ? strtoul(argv[2], NULL, 10) : 2000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--torture-save") {
+        runSaveTortureTest(argc > 2 ? atoi(argv[2]) : 200);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--hash-report") {
+        runHashReport(argc > 2 ? argv[2] : "mixue.txt");
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--to-binary") {
+        return convertToSnapshot(argc > 2 ? argv[2] : "mixue.txt", argc > 3 ? argv[3] : "mixue.bin") ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--to-text") {
+        return convertToText(argc > 2 ? argv[2] : "mixue.bin", argc > 3 ? argv[3] : "mixue.txt") ? 0 : 1;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-columns") {
+        runColumnBenchmark();
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-simd") {
+        runSimdBenchmark(argc > 2 ? strtoul(argv[2], NULL, 10) : 16000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-names") {
+        runNameSearchBenchmark(argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-concurrent") {
+        runConcurrentBenchmark(argc > 2 ? strtoul(argv[2], NULL, 10) : 8);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-orders") {
+        runOrderBenchmark(argc > 2 ? strtoul(argv[2], NULL, 10) : 64);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-outlets") {
+        runOutletBenchmark(argc > 2 ? strtoul(argv[2], NULL, 10) : 64);
+        return 0;
+    }
+    if (argc > 2 && string(argv[1]) == "--load-test") {
+#ifdef HAVE_CATALOG_SERVICE
+        runServiceLoadTest(argv[2], argc > 3 ? strtoul(argv[3], NULL, 10) : 4, argc > 4 ? atof(argv[4]) : 3);
+#else
+        cout << "The catalog service needs epoll and only runs on Linux.\n";
+#endif
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--memory-report") {
+        runMemoryReport(argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000);
+        return 0;
+    }
+    if (argc > 1 && string(argv[1]) == "--bench-startup") {
+        runStartupBenchmark(argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000);
+        return 0;
+    }
+    
     HashTable shop;
-    shop.loadFromFile("mixue.txt");
+    bool verbose = false;    // --verbose echoes every record while loading, like the old loader
+    unsigned threads = max(1u, thread::hardware_concurrency());   // --threads N overrides
+    string snapshotFile;     // --snapshot mixue.bin starts from a binary snapshot instead of mixue.txt
+    string serveAddress;     // --serve ADDRESS answers requests over a socket instead of showing the menu
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--verbose") {
+            verbose = true;
+        } else if (string(argv[i]) == "--threads" && i + 1 < argc) {
+            threads = max(1, atoi(argv[++i]));
+        } else if (string(argv[i]) == "--snapshot" && i + 1 < argc) {
+            snapshotFile = argv[++i];
+        } else if (string(argv[i]) == "--serve" && i + 1 < argc) {
+            serveAddress = argv[++i];
+        }
+    }
+    bool loaded = false;
+    if (!snapshotFile.empty()) {
+        // The journal is replayed over mixue.txt, so a snapshot taken before mixue.txt was
+        // last rewritten would be missing changes that are no longer in the journal
+        if (fileModifiedTime(snapshotFile) < fileModifiedTime("mixue.txt")) {
+            cout << snapshotFile << " is older than mixue.txt, loading mixue.txt instead\n";
+        } else {
+            loaded = shop.loadFromSnapshot(snapshotFile);
+        }
+    }
+    if (!loaded) {
+        shop.loadFromFile("mixue.txt", verbose, threads);
+    }
+    Journal journal("mixue.txt", "mixue.journal");
+    size_t replayed = journal.recover(shop);    // Changes made since mixue.txt was last written
+    if (replayed > 0) {
+        cout << "Replayed " << replayed << " journal records\n";
+    }
+    if (!serveAddress.empty()) {
+#ifdef HAVE_CATALOG_SERVICE
+        CatalogService service(shop, journal);
+        if (!service.start(serveAddress)) {
+            return 1;
+        }
+        cout << "Serving the catalog on " << serveAddress << ", Ctrl+C to stop" << endl;
+        size_t served = service.run();
+        cout << "Stopped after " << served << " requests\n";
+        writeStatsDump(shop);
+        return 0;
+#else
+        cout << "The catalog service needs epoll and only runs on Linux.\n";
+        return 1;
+#endif
+    }
 
     int choice;
     do {
@@ -294,6 +5314,8 @@ int main() {
     
         cout << endl;
         printCentered("1. Manage Items");
+        printCentered("2. Place Order");
+        printCentered("3. Statistics");
         printCentered("0. Exit");
         cout << "\nEnter choice: ";
         if (!(cin >> choice)) {
@@ -305,18 +5327,25 @@ int main() {
         }
 
         if (choice == 1) {
-            manageItemsMenu(shop);
+            manageItemsMenu(shop, journal);
+        } else if (choice == 2) {
+            placeOrderMenu(shop, journal);
+        } else if (choice == 3) {
+            clearScreen();
+            showStatistics(shop);
+            waitForEnter();
         } else if (choice != 0) {
             cout << "Invalid choice, try again.\n";
-            pause();
+            waitForEnter();
         }
     } while (choice != 0);
 
     cout << "Exiting program.\n";
     return 0;
 }
+#endif
 
-void manageItemsMenu(HashTable& shop) {
+void manageItemsMenu(HashTable& shop, Journal& journal) {
     int choice;
     do {
         clearScreen();
@@ -329,6 +5358,8 @@ void manageItemsMenu(HashTable& shop) {
         printCentered("5. Remove a Drink\n");
         printCentered("6. Update Drink Details\n");
         printCentered("7. Save Changes to File\n");
+        printCentered("8. Display Type Summary\n");
+        printCentered("9. Inventory Report\n");
         printCentered("0. Back to Main Menu\n");
         cout << "Please choose an option: ";
 
@@ -344,15 +5375,14 @@ void manageItemsMenu(HashTable& shop) {
             clearScreen();
             string name, type;
             cout << "Add New Drink\n";
-            cout << "Enter name: ";
-            getline(cin, name);
-            cout << "Enter type: ";
-            getline(cin, type);
+            name = getValidatedField("Enter name: ");
+            type = getValidatedField("Enter type: ");
             double price = getValidatedDouble("Enter price: ");
             int stock = getValidatedInt("Enter stock: ");
+            journal.logInsert(name, type, price, stock);
             shop.insert(name, type, price, stock);
             cout << "Drink added successfully! \n";
-            pause();
+            waitForEnter();
 
         } else if (choice == 2) {  //Search Drink
             clearScreen();
@@ -363,18 +5393,29 @@ void manageItemsMenu(HashTable& shop) {
             Drink* d = shop.search(name);
             if (d != NULL) {
                 cout << "Drink found: " << d->name
-                     << ", Type: " << d->type
+                     << ", Type: " << shop.typeName(d)
                      << ", Price: RM" << d->price
                      << ", Stock: " << d->stock << endl;
             } else {
-                cout << "No matching drink found.\n";
+                vector<Drink*> close = name.empty() ? vector<Drink*>() : shop.suggest(name, 5);
+                if (close.empty()) {
+                    cout << "No matching drink found.\n";
+                } else {
+                    cout << "No exact match. Did you mean:\n";
+                    for (size_t i = 0; i < close.size(); i++) {
+                        cout << "  " << close[i]->name
+                             << ", Type: " << shop.typeName(close[i])
+                             << ", Price: RM" << close[i]->price
+                             << ", Stock: " << close[i]->stock << endl;
+                    }
+                }
             }
-            pause();
+            waitForEnter();
 
         } else if (choice == 3) {  //Display All Drinks
             clearScreen();
             shop.displayAll();
-            pause();
+            waitForEnter();
 
 		} else if (choice == 4) {  //Display Drinks by Type
             clearScreen();
@@ -382,7 +5423,7 @@ void manageItemsMenu(HashTable& shop) {
             cout << "Enter drink type to display: ";
             getline(cin, type);
 			shop.displayByType(type);
-            pause();
+            waitForEnter();
 
 
         } else if (choice == 5) {  //Remove Drink
@@ -392,12 +5433,15 @@ void manageItemsMenu(HashTable& shop) {
             cout << "Enter name: ";
             getline(cin, name);
             bool removed = shop.remove(name);
+            if (removed) {
+                journal.logRemove(name);
+            }
             if (removed) {
                 cout << "Drink successfully removed from the list.\n";
             } else {
                 cout << "Drink not found.\n";
             }
-            pause();
+            waitForEnter();
 
         } else if (choice == 6) {
     		clearScreen();
@@ -405,42 +5449,218 @@ void manageItemsMenu(HashTable& shop) {
     		cout << "Update Drink\n ";
     		cout << "Enter name: ";
     		getline(cin, name);
-    		Drink* d = shop.search(name);
-    		if (d != NULL) {
-        		cout << "Current type: " << d->type << endl;
-        		cout << "Enter new type: ";
-        		string newType;
-        		getline(cin, newType);
-
-        		cout << "Current price: RM" << d->price << endl;
+    		DrinkInfo current;     // A copy, the prompts below do not hold on to the drink itself
+    		if (shop.lookup(name, current)) {
+        		cout << "Current type: " << current.type << endl;
+        		string newType = getValidatedField("Enter new type: ");
+
+        		cout << "Current price: RM" << current.price << endl;
         		double newPrice = getValidatedDouble("Enter new price: ");
 
-        		cout << "Current stock: " << d->stock << endl;
+        		cout << "Current stock: " << current.stock << endl;
         		int newStock = getValidatedInt("Enter new stock: ");
 
-        		// Update all fields
-        		d->type = newType;
-        		d->price = newPrice;
-        		d->stock = newStock;
-
-        		cout << "Drink updated.\n";
+        		// Update all fields, looking the drink up again by name
+        		Drink* d = shop.search(current.name);
+        		if (d != NULL) {
+        			journal.logInsert(current.name, newType, newPrice, newStock);
+        			shop.setDetails(d, newType, newPrice, newStock);
+        			cout << "Drink updated.\n";
+        		} else {
+        			cout << "Drink not found.\n";
+        		}
     		} else {
         		cout << "Drink not found.\n";
     		}
-   		 	pause();
+   		 	waitForEnter();
    		 	
 		} else if (choice == 7) {  //Save data to File
             clearScreen();
-            shop.saveToFile("mixue.txt");
-            pause();
+            if (journal.compact(shop, true)) {    // Write the snapshot now and start an empty journal
+                cout << "Changes saved to mixue.txt" << endl;
+            } else {
+                cout << "Could not save to mixue.txt, the changes are still in the journal" << endl;
+            }
+            waitForEnter();
+
+        } else if (choice == 8) {  //Per-type counts and stock totals
+            clearScreen();
+            shop.displayTypeSummary();
+            waitForEnter();
+
+        } else if (choice == 9) {  //Stock value, low stock and price band from the column scans
+            clearScreen();
+            int threshold = getValidatedInt("Show drinks with stock below: ");
+            double lowPrice = getValidatedDouble("Lowest price (RM): ");
+            double highPrice = getValidatedDouble("Highest price (RM): ");
+            shop.displayInventoryReport(threshold, lowPrice, highPrice);
+            waitForEnter();
 
         } else if (choice == 0) {  //Back to Main Menu
             break;
 
         } else {
             cout << "Invalid choice, try again.\n";
-            pause();
+            waitForEnter();
         }
 
     } while (choice != 0);
-}
\ No newline at end of file
+}
+
+// Reads "name quantity" lines until an empty one, then sells them as one order: either every
+// line is taken off the stock, or none is. The order is on disk before it is confirmed.
+void placeOrderMenu(HashTable& shop, Journal& journal) {
+    clearScreen();
+    cout << "Place Order\n";
+    cout << "Enter each item as: name quantity (empty line to finish)\n";
+    vector<OrderLine> lines;
+    string text;
+    while (getline(cin, text) && !isBlankLine(text.data(), text.data() + text.size())) {
+        size_t end = text.find_last_not_of(" \t\r");
+        size_t split = text.find_last_of(" \t", end);
+        OrderLine line;
+        const char* qty = text.data() + (split == string::npos ? 0 : split + 1);
+        const char* qtyEnd = text.data() + end + 1;
+        if (split == string::npos || from_chars(qty, qtyEnd, line.quantity).ptr != qtyEnd || line.quantity < 1) {
+            cout << "Invalid item, use: name quantity (at least 1)\n";
+            continue;
+        }
+        size_t start = text.find_first_not_of(" \t");
+        line.name = text.substr(start, text.find_last_not_of(" \t", split) + 1 - start);
+        lines.push_back(line);
+    }
+    if (lines.empty()) {
+        cout << "No items entered.\n";
+        waitForEnter();
+        return;
+    }
+    
+    string record;
+    OrderResult result = shop.placeOrder(lines, record);
+    if (result.filled && !journal.waitDurable(journal.logOrder(record))) {
+        shop.cancelOrder(lines);
+        cout << "Order refused, it could not be saved to the journal\n";
+    } else if (result.filled) {
+        cout << "Order placed:\n";
+        for (size_t i = 0; i < lines.size(); i++) {
+            Drink* d = shop.search(lines[i].name);
+            cout << "  " << lines[i].quantity << " x " << d->name << ", stock left: " << d->stock << endl;
+        }
+    } else if (result.unknownDrink) {
+        cout << "Order refused, no drink named " << lines[result.failedLine].name << endl;
+    } else {
+        cout << "Order refused, not enough stock for " << lines[result.failedLine].name << endl;
+    }
+    waitForEnter();
+}
+
+#ifdef MIXUE_LIBRARY
+}   // namespace hash_catalog
+
+// The hash table behind the benchmark's interface (catalog_bench.h)
+class HashCatalog : public BenchCatalog {
+private:
+    hash_catalog::HashTable* shop;
+    
+public:
+    HashCatalog() : shop(new hash_catalog::HashTable()) {
+    }
+    
+    ~HashCatalog() {
+        delete shop;
+    }
+    
+    const char* name() const {
+        return "hash_table";
+    }
+    
+    bool load(const std::string& path) {
+        delete shop;
+        shop = new hash_catalog::HashTable();
+        return shop->loadFromFile(path, false, std::max(1u, std::thread::hardware_concurrency())).records > 0;
+    }
+    
+    // Names are unique across types, so the type is not needed
+    bool lookup(const std::string& name, const std::string&) {
+        return shop->search(name) != NULL;
+    }
+    
+    size_t listType(const std::string& type, long long& stock) {
+        const hash_catalog::TypeEntry* e = shop->findType(type);
+        size_t n = 0;
+        for (const hash_catalog::Drink* d = e != NULL ? e->first : NULL; d != NULL; d = d->nextOfType) {
+            stock += d->stock;
+            n++;
+        }
+        return n;
+    }
+    
+    // The table keeps no order, so a sorted listing has to gather the drinks and sort them.
+    // As in NameIndex::build the sort runs on small keys, here the type's rank and the first
+    // eight bytes of the name packed big-endian, and reads the names only on a tie.
+    size_t sortDrinks() {
+        struct SortKey {
+            uint64_t rank;
+            uint64_t head;
+            const hash_catalog::Drink* drink;
+        };
+        std::vector<const char*> typeText;    // By spelling id
+        std::vector<SortKey> keys;
+        keys.reserve(shop->size());
+        shop->forEachDrink([&](const hash_catalog::Drink* d) {
+            if (d->spellingId >= typeText.size()) {
+                typeText.resize(d->spellingId + 1, NULL);
+            }
+            typeText[d->spellingId] = shop->typeName(d);
+            uint64_t head = 0;
+            for (size_t c = 0; c < 8; c++) {
+                head = (head << 8) | (c < d->nameLength ? (unsigned char)d->name[c] : 0);
+            }
+            SortKey key = {d->spellingId, head, d};
+            keys.push_back(key);
+        });
+        std::vector<uint32_t> byText;
+        for (uint32_t id = 0; id < typeText.size(); id++) {
+            if (typeText[id] != NULL) {
+                byText.push_back(id);
+            }
+        }
+        std::sort(byText.begin(), byText.end(), [&](uint32_t a, uint32_t b) {
+            return strcmp(typeText[a], typeText[b]) < 0;
+        });
+        std::vector<uint64_t> rank(typeText.size());
+        for (size_t r = 0; r < byText.size(); r++) {
+            rank[byText[r]] = r;
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            keys[i].rank = rank[keys[i].rank];
+        }
+        std::sort(keys.begin(), keys.end(), [](const SortKey& a, const SortKey& b) {
+            if (a.rank != b.rank) return a.rank < b.rank;
+            if (a.head != b.head) return a.head < b.head;
+            return std::string_view(a.drink->name, a.drink->nameLength) < std::string_view(b.drink->name, b.drink->nameLength);
+        });
+        return keys.size();
+    }
+    
+    bool insert(const BenchDrink& d) {
+        return shop->insert(d.name, d.type, d.price, d.stock);
+    }
+    
+    bool remove(const std::string& name, const std::string&) {
+        return shop->remove(name);
+    }
+    
+    bool save(const std::string& path) {
+        return shop->saveToFile(path);
+    }
+    
+    size_t size() const {
+        return shop->size();
+    }
+};
+
+BenchCatalog* newHashCatalog() {
+    return new HashCatalog();
+}
+#endif
\ No newline at end of file